@@ -0,0 +1,1156 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "attractorCore.h"
+#include "memoryTracker.h"
+
+// * CONTEXT
+struct AttractorContext {
+    enum StrangeAttractorType type;
+    StrangeAttractor model;
+    struct Frustum frustum;
+    struct Bounds bounds;
+    struct VertexBuffer vertices;
+    float *rows;
+    int rowLength;
+    struct Lyapunov lyapunov;
+};
+
+// * CONSTANTS
+static const float aspect_ratio = VIEW_WIDTH/VIEW_HEIGHT;
+static const float FOV = 3.5;
+static const double default_x = 0.01;
+static const double default_y = 0.01;
+static const double default_z = 0.01;
+enum CpuLevel cpuLevel = CPU_GENERIC;
+const char *cpuLevelNames[CPU_LEVELS] = {"generic", "sse2", "avx", "avx2", "avx512"};
+const char *attractorNames[MODEL_COUNT] = {"lorenz", "banlue", "halvorsen", "aizawa", "luchen", "genesio"};
+
+// Strange Attractor Models
+const StrangeAttractor attractorDefaults[MODEL_COUNT] = {
+    // ? LORENZ MODEL
+    {
+        .dtime = 0.005,
+        .zoom = 0.17,
+        .attractorFunction = LorenzAttractor,
+        .parameters = {10.0, 28.0, 8.0/3.0},
+        .initialPosition = {0.8, 0.5, 4.1},
+        .midpoint = {1.94, 3.53, 25.57},
+        .rotation = {.dangle_x = 0.000000, 0.000001, 0.000000},
+        .trail = {.maxLength = 1000,}
+    },
+    // ? BANLUE MODEL
+    {
+        .dtime = 0.02,
+        .zoom = 0.25,
+        .attractorFunction = BanlueAttractor,
+        .parameters = {2, 0, 0},
+        .initialPosition = {0.8, 0.5, 0.1},
+        .midpoint = {-0.18, -0.34, 0.75},
+        .rotation = {.dangle_x = 0.000002, 0.000001, 0.000000},
+        .trail = {.maxLength = 1000}
+    },
+    // ? HALVORSEN MODEL
+    {
+        .dtime = 0.02,
+        .zoom = 0.2,
+        .attractorFunction = HalvorsenAttractor,
+        .parameters = {1.97, 0, 0},
+        .initialPosition = {0.8, 0.5, 4.1},
+        .midpoint = {-2.28, -3.88, -4.41},
+        .rotation = {.dangle_x = 0.000002, 0.000001, 0.000000},
+        .trail = {.maxLength = 3000}
+    },
+    // ? AIZAWA MODEL
+    {
+        .dtime = 0.0145,
+        .zoom = 0.65,
+        .attractorFunction = AizawaAttractor,
+        .parameters = {0.25, 0.96, 3.5},
+        .initialPosition = {0.01, 0.01, 0.01},
+        .midpoint = {-0.01, 0.05, 0.61},
+        .rotation = {.dangle_x = 0.000000, 0.000001, 0.0000005},
+        .trail = {.maxLength = 1000}
+    },
+    // ? LUCHEN MODEL
+    {
+        .dtime = 0.0027,
+        .zoom = 0.19,
+        .attractorFunction = LuChenAttractor,
+        .parameters = {-10.0, -4.0, 18.1},
+        .initialPosition = {0.8, 0.5, 4.1},
+        .midpoint = {3.29, 4.07, 18.24},
+        .rotation = {1.2, 0.2, 4.2, 0.000000, 0.000001, 0.000000},
+        .trail = {.maxLength = 2000}
+    },
+    // ? GENESIO MODEL
+    {
+        .dtime = 0.022,
+        .zoom = 0.75,
+        .attractorFunction = GenesioAttractor,
+        .parameters = {0.439, 1.1, 1.0},
+        .initialPosition = {0.1, 0.1, 0.0},
+        .midpoint = {0.34, 0.14, 0.05},
+        .rotation = {.dangle_x = 0.000000, 0.000002, 0.000001},
+        .trail = {.maxLength = 1000}
+    },
+};
+
+// * FUNCTION DEFINITIONS
+AttractorContext *attractorCreate(enum StrangeAttractorType type)
+{
+    AttractorContext *context = calloc(1, sizeof(AttractorContext));
+    if (!context) return NULL;
+
+    // Camera
+    context->frustum.n = 0.05;
+    context->frustum.f = 200.0; // Beyond the camera distance of the smallest zoom
+    context->frustum.r = context->frustum.n * tan(FOV / 2);
+    context->frustum.t = context->frustum.r / aspect_ratio;
+    context->bounds = (struct Bounds){100, -100, 100, -100, 100, -100};
+
+    // Model
+    context->type = type;
+    context->model = attractorDefaults[type];
+    attractorResetTrail(context);
+    return context;
+}
+
+void attractorDestroy(AttractorContext *context)
+{
+    if (!context) return;
+    freeTrail(&context->model);
+    memoryFree(context->vertices.data);
+    memoryFree(context->vertices.view);
+    memoryFree(context->vertices.lod);
+    memoryFree(context->rows);
+    free(context);
+    return;
+}
+
+void attractorSetModel(AttractorContext *context, enum StrangeAttractorType type)
+{
+    // When `type` is the current type this simply restarts the current attractor from its defaults
+    freeTrail(&context->model);
+    context->type = type;
+    context->model = attractorDefaults[type];
+    memset(&context->lyapunov, 0, sizeof(context->lyapunov));
+    attractorResetTrail(context);
+    return;
+}
+
+enum StrangeAttractorType attractorType(const AttractorContext *context)
+{
+    return context->type;
+}
+
+StrangeAttractor *attractorModel(AttractorContext *context)
+{
+    return &context->model;
+}
+
+const struct Frustum *attractorFrustum(const AttractorContext *context)
+{
+    return &context->frustum;
+}
+
+struct VertexBuffer *attractorVertices(AttractorContext *context)
+{
+    return &context->vertices;
+}
+
+const struct Bounds *attractorBounds(const AttractorContext *context)
+{
+    return &context->bounds;
+}
+
+void attractorStep(AttractorContext *context)
+{
+    StrangeAttractor *model = &context->model;
+
+    // * Calculate new point according to the model
+    struct Point *newPoint = memoryAlloc(sizeof(struct Point), MEMORY_TRAIL);
+    model->attractorFunction(newPoint, model->trail.tail, model);
+
+    // * Append new point to the model
+    newPoint->next = NULL;
+    model->trail.tail->next = newPoint;
+    model->trail.tail = newPoint;
+    model->trail.length++;
+    
+    // * Remove head(s)
+    int frees = (model->trail.length >= model->trail.maxLength) + (model->trail.length > model->trail.maxLength);
+    for (int i = 0; i < frees; i++) {
+        struct Point *oldHead = model->trail.head;
+        model->trail.head = model->trail.head->next;
+        memoryFree(oldHead);
+        model->trail.length--;
+    }
+
+    return;
+}
+
+void freeTrail(StrangeAttractor *model)
+{
+    // Iterative, trails can be far longer than the stack is deep
+    for (struct Point *point = model->trail.head; point != NULL; ) {
+        struct Point *next = point->next;
+        memoryFree(point);
+        point = next;
+    }
+    model->trail.head = NULL;
+    model->trail.tail = NULL;
+    model->trail.length = 0;
+    return;
+}
+
+void attractorResetTrail(AttractorContext *context)
+{
+    // Restarts the trail from the initial position with the current settings
+    StrangeAttractor *model = &context->model;
+    freeTrail(model);
+
+    // Initial point
+    model->trail.head = memoryAlloc(sizeof(struct Point), MEMORY_TRAIL);
+    model->trail.tail = model->trail.head;
+    model->trail.tail->next = NULL;
+    model->trail.tail->x = model->initialPosition.x;
+    model->trail.tail->y = model->initialPosition.y;
+    model->trail.tail->z = model->initialPosition.z;
+    model->trail.length++;
+
+    // Initial trail
+    struct Point *next_point = model->trail.tail;
+    while (model->trail.length < model->trail.maxLength) {
+        struct Point *new_point = memoryAlloc(sizeof(struct Point), MEMORY_TRAIL);
+        new_point->next = next_point;
+
+        new_point->x = default_x;
+        new_point->y = default_y;
+        new_point->z = default_z;
+        
+        next_point = new_point;
+        model->trail.head = new_point;
+        model->trail.length++;
+    }
+    return;
+}
+
+void attractorLoadTrail(AttractorContext *context, const float (*points)[3], int count)
+{
+    // Replaces the trail with `points`, oldest first, attractorStep() continues from the last one
+    StrangeAttractor *model = &context->model;
+    freeTrail(model);
+    for (int i = 0; i < count; i++) {
+        struct Point *point = memoryAlloc(sizeof(struct Point), MEMORY_TRAIL);
+        point->next = NULL;
+        point->x = points[i][0];
+        point->y = points[i][1];
+        point->z = points[i][2];
+        if (model->trail.tail) model->trail.tail->next = point;
+        else model->trail.head = point;
+        model->trail.tail = point;
+        model->trail.length++;
+    }
+    return;
+}
+
+CPU_INLINE void transformBody(const struct Frustum *frustum, const float *restrict rows, int count, int begin, int end, float mx, float my, float mz, double depth, struct Vertex *restrict view, struct Vertex *restrict data)
+{
+    // `rows` holds the points and the per point rotation as rows of `count`: x, y, z, then sine and cosine for X, Y and Z.
+    // Same arithmetic as rotateX/Y/Z and project, a zero angle has a sine of 0 and a cosine of 1 so skipping it is exact.
+    // Points behind the near plane get a meaningless projection, the clipper only uses their view position
+    const float *x = rows, *y = x + count, *z = y + count;
+    const float *sx = z + count, *cx = sx + count, *sy = cx + count, *cy = sy + count, *sz = cy + count, *cz = sz + count;
+    float scale_x = frustum->n / frustum->r, scale_y = frustum->n / frustum->t;
+    float fit_x = VIEW_WIDTH / (2 * frustum->r), fit_y = VIEW_HEIGHT / (2 * frustum->t);
+    for (int i = begin; i < end; i++) {
+        // * Center the model at (0,0,0) and rotate
+        float px = x[i] - mx, py = y[i] - my, pz = z[i] - mz;
+        float yr = (py * cx[i]) - (pz * sx[i]);
+        float zr = (py * sx[i]) + (pz * cx[i]);
+        py = yr;
+        pz = zr;
+        float xr = (pz * sy[i]) + (px * cy[i]);
+        zr = (pz * cy[i]) - (px * sy[i]);
+        px = xr;
+        pz = zr;
+        xr = (px * cz[i]) - (py * sz[i]);
+        yr = (px * sz[i]) + (py * cz[i]);
+        px = xr;
+        py = yr;
+        pz += depth;
+        view[i].x = px;
+        view[i].y = py;
+        view[i].z = pz;
+
+        // * Perspective projection
+        float xp = px * scale_x, yp = py * scale_y;
+        float zp = -pz * (frustum->f + pz + (2 * frustum->f * frustum->n)) / (frustum->f - frustum->n);
+        xp /= -pz;
+        yp /= -pz;
+        zp /= -pz;
+        data[i].x = (xp + frustum->r) * fit_x;
+        data[i].y = (yp + frustum->t) * fit_y;
+        data[i].z = zp;
+    }
+    return;
+}
+CPU_VARIANTS(transform, (const struct Frustum *frustum, const float *restrict rows, int count, int begin, int end, float mx, float my, float mz, double depth, struct Vertex *restrict view, struct Vertex *restrict data), (frustum, rows, count, begin, end, mx, my, mz, depth, view, data));
+
+int attractorTransform(AttractorContext *context)
+{
+    // Returns the number of points transformed
+    int count = attractorGather(context);
+    attractorProject(context, 0, count);
+    return count;
+}
+
+int attractorGather(AttractorContext *context)
+{
+    // Sequential half of the transform, returns the number of points gathered for attractorProject()
+    StrangeAttractor *model = &context->model;
+    struct VertexBuffer *trailVertices = &context->vertices;
+    struct Bounds *bounds = &context->bounds;
+
+    // * Make room for every point in the trail
+    if (trailVertices->capacity < model->trail.length) {
+        trailVertices->capacity = model->trail.length;
+        trailVertices->data = memoryRealloc(trailVertices->data, trailVertices->capacity * sizeof(struct Vertex), MEMORY_VERTICES);
+        trailVertices->view = memoryRealloc(trailVertices->view, trailVertices->capacity * sizeof(struct Vertex), MEMORY_VERTICES);
+        trailVertices->lod = memoryRealloc(trailVertices->lod, trailVertices->capacity * sizeof(int), MEMORY_VERTICES);
+        context->rows = memoryRealloc(context->rows, 9 * trailVertices->capacity * sizeof(float), MEMORY_VERTICES);
+    }
+
+    // * Gather the list into rows and advance the angles, both are sequential
+    int count = model->trail.length, i = 0;
+    float *x = context->rows, *y = x + count, *z = y + count;
+    float *sx = z + count, *cx = sx + count, *sy = cx + count, *cy = sy + count, *sz = cy + count, *cz = sz + count;
+    for (struct Point *current_point = model->trail.head; current_point != NULL && i < count; current_point = current_point->next, i++) {
+        x[i] = current_point->x;
+        y[i] = current_point->y;
+        z[i] = current_point->z;
+
+        // Calculate midpoints
+        {
+            if (current_point->x > bounds->maxx) bounds->maxx = current_point->x;
+            if (current_point->x < bounds->minx) bounds->minx = current_point->x;
+            if (current_point->y > bounds->maxy) bounds->maxy = current_point->y;
+            if (current_point->y < bounds->miny) bounds->miny = current_point->y;
+            if (current_point->z > bounds->maxz) bounds->maxz = current_point->z;
+            if (current_point->z < bounds->minz) bounds->minz = current_point->z;
+        }
+
+        // Rotation of this point, the angles are rounded to float like rotateX/Y/Z do
+        float angle_x = model->rotation.angle_x, angle_y = model->rotation.angle_y, angle_z = model->rotation.angle_z;
+        sx[i] = angle_x == 0 ? 0 : sin(angle_x);
+        cx[i] = angle_x == 0 ? 1 : cos(angle_x);
+        sy[i] = angle_y == 0 ? 0 : sin(angle_y);
+        cy[i] = angle_y == 0 ? 1 : cos(angle_y);
+        sz[i] = angle_z == 0 ? 0 : sin(angle_z);
+        cz[i] = angle_z == 0 ? 1 : cos(angle_z);
+
+        // * Increment angle
+        model->rotation.angle_x = fmod(model->rotation.angle_x + model->rotation.dangle_x, 2 * PI);
+        model->rotation.angle_y = fmod(model->rotation.angle_y + model->rotation.dangle_y, 2 * PI);
+        model->rotation.angle_z = fmod(model->rotation.angle_z + model->rotation.dangle_z, 2 * PI);
+    }
+
+    trailVertices->count = i;
+    context->rowLength = count;
+    return i;
+}
+
+void attractorProject(AttractorContext *context, int begin, int end)
+{
+    // Rotates and projects the gathered points [begin, end) with the kernel for this CPU.
+    // Points are independent, so ranges can run on different threads
+    StrangeAttractor *model = &context->model;
+    struct VertexBuffer *trailVertices = &context->vertices;
+    transformVariants[cpuLevel](&context->frustum, context->rows, context->rowLength, begin, end, model->midpoint.x, model->midpoint.y, model->midpoint.z, 1 / (model->zoom*model->zoom), trailVertices->view, trailVertices->data);
+    return;
+}
+
+void attractorDecimate(AttractorContext *context, float scale)
+{
+    // Runs of vertices that stay within `LOD_PIXEL_ERROR` target pixels of the last kept vertex are merged.
+    // Every dropped vertex is then within the error of the kept one, and so of the merged segment.
+    // Vertices outside the depth range are always kept so the clipper sees the real crossing
+    struct VertexBuffer *trailVertices = &context->vertices;
+    const struct Frustum *frustum = &context->frustum;
+    float error = LOD_PIXEL_ERROR / scale;
+    float error2 = error * error;
+    struct Vertex *vertices = trailVertices->data;
+    struct Vertex *view = trailVertices->view;
+    int count = 0;
+
+    for (int i = 0; i < trailVertices->count; i++) {
+        int visible = view[i].z >= frustum->n && view[i].z <= frustum->f;
+        if (count && i != trailVertices->count - 1 && visible) {
+            int anchor = trailVertices->lod[count - 1];
+            int anchor_visible = view[anchor].z >= frustum->n && view[anchor].z <= frustum->f;
+            float dx = vertices[i].x - vertices[anchor].x;
+            float dy = vertices[i].y - vertices[anchor].y;
+            if (anchor_visible && dx * dx + dy * dy < error2) continue;
+        }
+        trailVertices->lod[count++] = i;
+    }
+    trailVertices->lodCount = count;
+    return;
+}
+
+int clipSegment(const struct Frustum *frustum, const struct Vertex *view_0, const struct Vertex *view_1, struct Vertex *p0, struct Vertex *p1, const struct ClipRect *clip)
+{
+    // Returns 0 when nothing of the segment is visible, otherwise `p0` and `p1` are
+    // replaced by the projected end points of the visible part, inside `clip`
+
+    // * Trivial reject against the near and far planes
+    if ((view_0->z < frustum->n && view_1->z < frustum->n) || (view_0->z > frustum->f && view_1->z > frustum->f))
+        return 0;
+
+    // * Clip against the near and far planes in view space, before the divide by depth
+    float t0 = 0, t1 = 1;
+    float dz = view_1->z - view_0->z;
+    if (view_0->z < frustum->n) t0 = (frustum->n - view_0->z) / dz;
+    if (view_1->z < frustum->n) t1 = (frustum->n - view_0->z) / dz;
+    if (view_0->z > frustum->f) t0 = (frustum->f - view_0->z) / dz;
+    if (view_1->z > frustum->f) t1 = (frustum->f - view_0->z) / dz;
+    if (t0 > 0) project(frustum, view_0->x + t0 * (view_1->x - view_0->x), view_0->y + t0 * (view_1->y - view_0->y), view_0->z + t0 * dz, &p0->x, &p0->y, &p0->z);
+    if (t1 < 1) project(frustum, view_0->x + t1 * (view_1->x - view_0->x), view_0->y + t1 * (view_1->y - view_0->y), view_0->z + t1 * dz, &p1->x, &p1->y, &p1->z);
+
+    // * Trivial reject when both ends are past the same screen edge
+    float left = clip->x, top = clip->y, right = clip->x + clip->w, bottom = clip->y + clip->h;
+    if ((p0->x < left && p1->x < left) || (p0->x > right && p1->x > right) || (p0->y < top && p1->y < top) || (p0->y > bottom && p1->y > bottom))
+        return 0;
+
+    // * Liang-Barsky against the screen rectangle, keeps coordinates inside the Sint16 range of SDL2_gfx
+    float dx = p1->x - p0->x, dy = p1->y - p0->y, dzp = p1->z - p0->z;
+    float p[4] = {-dx, dx, -dy, dy};
+    float q[4] = {p0->x - left, right - p0->x, p0->y - top, bottom - p0->y};
+    float u0 = 0, u1 = 1;
+    for (int k = 0; k < 4; k++) {
+        if (p[k] == 0) {
+            if (q[k] < 0) return 0;
+            continue;
+        }
+        float u = q[k] / p[k];
+        if (p[k] < 0 && u > u0) u0 = u;
+        if (p[k] > 0 && u < u1) u1 = u;
+        if (u0 > u1) return 0;
+    }
+    struct Vertex start = *p0;
+    if (u1 < 1) {
+        p1->x = start.x + u1 * dx;
+        p1->y = start.y + u1 * dy;
+        p1->z = start.z + u1 * dzp;
+    }
+    if (u0 > 0) {
+        p0->x = start.x + u0 * dx;
+        p0->y = start.y + u0 * dy;
+        p0->z = start.z + u0 * dzp;
+    }
+    return 1;
+}
+
+void project(const struct Frustum *frustum, float x, float y, float z, float *x_proj, float *y_proj, float *z_proj)
+{
+    // Project
+    *x_proj = x * (frustum->n / frustum->r);
+    *y_proj = y * (frustum->n / frustum->t);
+    *z_proj = -z * (frustum->f + z + (2 * frustum->f * frustum->n)) / (frustum->f - frustum->n);
+
+    // Homogenize
+    *x_proj /= -z;
+    *y_proj /= -z;
+    *z_proj /= -z;
+
+    // Translate to screen
+    *x_proj += frustum->r;
+    *y_proj += frustum->t;
+
+    // Fit screen
+    *x_proj *= VIEW_WIDTH / (2 * frustum->r);
+    *y_proj *= VIEW_HEIGHT / (2 * frustum->t);
+
+    return;
+}
+
+void rotateX(float *x, float *y, float *z, float angle)
+{
+    if (angle == 0) return;
+    float s = sin(angle);
+    float c = cos(angle);
+    float yr = (*y * c) - (*z * s);
+    float zr = (*y * s) + (*z * c);
+    *y = yr;
+    *z = zr;
+    return;
+}
+
+void rotateY(float *x, float *y, float *z, float angle)
+{
+    if (angle == 0) return;
+    float s = sin(angle);
+    float c = cos(angle);
+    float xr = (*z * s) + (*x * c);
+    float zr = (*z * c) - (*x * s);
+    *x = xr;
+    *z = zr;
+    return;
+}
+
+void rotateZ(float *x, float *y, float *z, float angle)
+{
+    if (angle == 0) return;
+    float c = cos(angle);
+    float s = sin(angle);
+    float xr = (*x * c) - (*y * s);
+    float yr = (*x * s) + (*y * c);
+    *x = xr;
+    *y = yr;
+    return;
+}
+
+// * SCALARS
+// The models are written once against the operations below, `op` picks the scalar type. `real` expands to the plain
+// C expressions for float and double state, `dual` carries the derivatives with respect to the point alongside the
+// value (forward mode), so one evaluation gives the step and its Jacobian
+#define realAdd(p, q) ((p) + (q))
+#define realSub(p, q) ((p) - (q))
+#define realMul(p, q) ((p) * (q))
+#define realNeg(p) (-(p))
+#define realScale(k, p) ((k) * (p))
+#define realOffset(p, k) ((p) + (k))
+#define realDivide(p, k) ((p) / (k))
+#define realTanh(p) tanh(p)
+#define realAbs(p) abs(p)
+
+struct Dual {
+    double value;
+    double dx;
+    double dy;
+    double dz;
+};
+
+CPU_INLINE struct Dual dualAdd(struct Dual p, struct Dual q)
+{
+    return (struct Dual){p.value + q.value, p.dx + q.dx, p.dy + q.dy, p.dz + q.dz};
+}
+
+CPU_INLINE struct Dual dualSub(struct Dual p, struct Dual q)
+{
+    return (struct Dual){p.value - q.value, p.dx - q.dx, p.dy - q.dy, p.dz - q.dz};
+}
+
+CPU_INLINE struct Dual dualMul(struct Dual p, struct Dual q)
+{
+    return (struct Dual){p.value * q.value, p.dx * q.value + p.value * q.dx, p.dy * q.value + p.value * q.dy, p.dz * q.value + p.value * q.dz};
+}
+
+CPU_INLINE struct Dual dualNeg(struct Dual p)
+{
+    return (struct Dual){-p.value, -p.dx, -p.dy, -p.dz};
+}
+
+CPU_INLINE struct Dual dualScale(double k, struct Dual p)
+{
+    return (struct Dual){k * p.value, k * p.dx, k * p.dy, k * p.dz};
+}
+
+CPU_INLINE struct Dual dualOffset(struct Dual p, double k)
+{
+    return (struct Dual){p.value + k, p.dx, p.dy, p.dz};
+}
+
+CPU_INLINE struct Dual dualDivide(struct Dual p, double k)
+{
+    return (struct Dual){p.value / k, p.dx / k, p.dy / k, p.dz / k};
+}
+
+CPU_INLINE struct Dual dualTanh(struct Dual p)
+{
+    double t = tanh(p.value), slope = 1 - t * t;
+    return (struct Dual){t, p.dx * slope, p.dy * slope, p.dz * slope};
+}
+
+CPU_INLINE struct Dual dualAbs(struct Dual p)
+{
+    // Banlue's abs() truncates to int like the float kernels, a step function with zero derivative
+    return (struct Dual){abs((int)p.value), 0, 0, 0};
+}
+
+// * ATTRACTOR FUNCTIONS
+// One explicit Euler step of each model in place, shared by the single point kernels, the batched integrator
+// and the analysis code. ATTRACTOR_STEPS instantiates them for float state (`xStep`), double state (`xStepDouble`)
+// and dual numbers (`xStepTangent`)
+#define ATTRACTOR_STEPS(type, suffix, op) \
+    CPU_INLINE void banlueStep##suffix(type *x, type *y, type *z, double a, double b, double c, double dt) \
+    { \
+        type x0 = *x, y0 = *y, z0 = *z; \
+        *x = op##Add(x0, op##Scale(dt, op##Sub(y0, x0))); \
+        *y = op##Add(y0, op##Scale(dt, op##Mul(op##Neg(z0), op##Tanh(x0)))); \
+        *z = op##Add(z0, op##Scale(dt, op##Add(op##Offset(op##Mul(x0, y0), -a), op##Abs(y0)))); \
+        return; \
+    } \
+    \
+    CPU_INLINE void lorenzStep##suffix(type *x, type *y, type *z, double a, double b, double c, double dt) \
+    { \
+        type x0 = *x, y0 = *y, z0 = *z; \
+        *x = op##Add(x0, op##Scale(dt, op##Scale(a, op##Sub(y0, x0)))); \
+        *y = op##Add(y0, op##Scale(dt, op##Sub(op##Mul(x0, op##Offset(op##Neg(z0), b)), y0))); \
+        *z = op##Add(z0, op##Scale(dt, op##Sub(op##Mul(x0, y0), op##Scale(c, z0)))); \
+        return; \
+    } \
+    \
+    CPU_INLINE void halvorsenStep##suffix(type *x, type *y, type *z, double a, double b, double c, double dt) \
+    { \
+        type x0 = *x, y0 = *y, z0 = *z; \
+        *x = op##Add(x0, op##Scale(dt, op##Sub(op##Sub(op##Sub(op##Scale(-a, x0), op##Scale(4, y0)), op##Scale(4, z0)), op##Mul(y0, y0)))); \
+        *y = op##Add(y0, op##Scale(dt, op##Sub(op##Sub(op##Sub(op##Scale(-a, y0), op##Scale(4, z0)), op##Scale(4, x0)), op##Mul(z0, z0)))); \
+        *z = op##Add(z0, op##Scale(dt, op##Sub(op##Sub(op##Sub(op##Scale(-a, z0), op##Scale(4, x0)), op##Scale(4, y0)), op##Mul(x0, x0)))); \
+        return; \
+    } \
+    \
+    CPU_INLINE void aizawaStep##suffix(type *x, type *y, type *z, double a, double b, double c, double dt) \
+    { \
+        type x0 = *x, y0 = *y, z0 = *z; \
+        *x = op##Add(x0, op##Scale(dt, op##Sub(op##Mul(op##Offset(z0, -0.7), x0), op##Scale(c, y0)))); \
+        *y = op##Add(y0, op##Scale(dt, op##Add(op##Scale(c, x0), op##Mul(op##Offset(z0, -0.7), y0)))); \
+        *z = op##Add(z0, op##Scale(dt, op##Add(op##Sub(op##Sub(op##Offset(op##Scale(b, z0), 0.6), \
+            op##Divide(op##Mul(op##Mul(z0, z0), z0), 3)), \
+            op##Mul(op##Add(op##Mul(x0, x0), op##Mul(y0, y0)), op##Offset(op##Scale(a, z0), 1))), \
+            op##Mul(op##Mul(op##Mul(op##Scale(0.1, z0), x0), x0), x0)))); \
+        return; \
+    } \
+    \
+    CPU_INLINE void luChenStep##suffix(type *x, type *y, type *z, double a, double b, double c, double dt) \
+    { \
+        type x0 = *x, y0 = *y, z0 = *z; \
+        *x = op##Add(x0, op##Scale(dt, op##Offset(op##Sub(op##Neg(op##Divide(op##Scale(a*b, x0), (a+b))), op##Mul(y0, z0)), c))); \
+        *y = op##Add(y0, op##Scale(dt, op##Add(op##Scale(a, y0), op##Mul(x0, z0)))); \
+        *z = op##Add(z0, op##Scale(dt, op##Add(op##Scale(b, z0), op##Mul(x0, y0)))); \
+        return; \
+    } \
+    \
+    CPU_INLINE void genesioStep##suffix(type *x, type *y, type *z, double a, double b, double c, double dt) \
+    { \
+        type x0 = *x, y0 = *y, z0 = *z; \
+        *x = op##Add(x0, op##Scale(dt, y0)); \
+        *y = op##Add(y0, op##Scale(dt, z0)); \
+        *z = op##Add(z0, op##Scale(dt, op##Add(op##Sub(op##Sub(op##Scale(-c, x0), op##Scale(b, y0)), op##Scale(a, z0)), op##Mul(x0, x0)))); \
+        return; \
+    }
+ATTRACTOR_STEPS(float, , real)
+ATTRACTOR_STEPS(double, Double, real)
+ATTRACTOR_STEPS(struct Dual, Tangent, dual)
+
+#define ATTRACTOR_KERNEL(name, step) \
+    void name(struct Point *newPoint, const struct Point *point, const struct StrangeAttractor *model) \
+    { \
+        float x = point->x, y = point->y, z = point->z; \
+        step(&x, &y, &z, model->parameters.a, model->parameters.b, model->parameters.c, model->dtime); \
+        newPoint->x = x; \
+        newPoint->y = y; \
+        newPoint->z = z; \
+        return; \
+    }
+ATTRACTOR_KERNEL(BanlueAttractor, banlueStep)
+ATTRACTOR_KERNEL(LorenzAttractor, lorenzStep)
+ATTRACTOR_KERNEL(HalvorsenAttractor, halvorsenStep)
+ATTRACTOR_KERNEL(AizawaAttractor, aizawaStep)
+ATTRACTOR_KERNEL(LuChenAttractor, luChenStep)
+ATTRACTOR_KERNEL(GenesioAttractor, genesioStep)
+
+// Batched integrators for float state (`integrateBody`) and double state (`integrateDoubleBody`).
+// The trajectories are independent so the inner loop over them is what gets vectorized
+#define INTEGRATE(step) \
+    for (int s = 0; s < steps; s++) \
+        for (int i = 0; i < count; i++) step(&x[i], &y[i], &z[i], a, b, c, dt)
+#define INTEGRATE_BODY(name, type, suffix) \
+    CPU_INLINE void name(const StrangeAttractor *model, type *restrict x, type *restrict y, type *restrict z, int count, int steps) \
+    { \
+        double a = model->parameters.a, b = model->parameters.b, c = model->parameters.c, dt = model->dtime; \
+        if (model->attractorFunction == LorenzAttractor) INTEGRATE(lorenzStep##suffix); \
+        else if (model->attractorFunction == BanlueAttractor) INTEGRATE(banlueStep##suffix); \
+        else if (model->attractorFunction == HalvorsenAttractor) INTEGRATE(halvorsenStep##suffix); \
+        else if (model->attractorFunction == AizawaAttractor) INTEGRATE(aizawaStep##suffix); \
+        else if (model->attractorFunction == LuChenAttractor) INTEGRATE(luChenStep##suffix); \
+        else if (model->attractorFunction == GenesioAttractor) INTEGRATE(genesioStep##suffix); \
+        else { \
+            /* Unknown kernel, one point at a time through the model's own function */ \
+            for (int s = 0; s < steps; s++) { \
+                for (int i = 0; i < count; i++) { \
+                    struct Point point = {NULL, x[i], y[i], z[i]}, next; \
+                    model->attractorFunction(&next, &point, model); \
+                    x[i] = next.x; \
+                    y[i] = next.y; \
+                    z[i] = next.z; \
+                } \
+            } \
+        } \
+        return; \
+    }
+INTEGRATE_BODY(integrateBody, float, )
+INTEGRATE_BODY(integrateDoubleBody, double, Double)
+#undef INTEGRATE_BODY
+#undef INTEGRATE
+CPU_VARIANTS(integrate, (const StrangeAttractor *model, float *restrict x, float *restrict y, float *restrict z, int count, int steps), (model, x, y, z, count, steps));
+CPU_VARIANTS(integrateDouble, (const StrangeAttractor *model, double *restrict x, double *restrict y, double *restrict z, int count, int steps), (model, x, y, z, count, steps));
+
+void attractorIntegrate(const StrangeAttractor *model, float *x, float *y, float *z, int count, int steps)
+{
+    integrateVariants[cpuLevel](model, x, y, z, count, steps);
+    return;
+}
+
+void attractorIntegrateDouble(const StrangeAttractor *model, double *x, double *y, double *z, int count, int steps)
+{
+    // Same steps as attractorOrbit() for many trajectories at once
+    integrateDoubleVariants[cpuLevel](model, x, y, z, count, steps);
+    return;
+}
+
+// * LYAPUNOV EXPONENT
+
+static int modelKind(const StrangeAttractor *model)
+{
+    // Which of the built in models `model` runs, -1 for any other kernel
+    for (int type = 0; type < MODEL_COUNT; type++)
+        if (model->attractorFunction == attractorDefaults[type].attractorFunction) return type;
+    return -1;
+}
+
+CPU_INLINE void stepKind(int kind, double *x, double *y, double *z, double a, double b, double c, double dt)
+{
+    switch (kind) {
+        case LORENZ: lorenzStepDouble(x, y, z, a, b, c, dt); break;
+        case BANLUE: banlueStepDouble(x, y, z, a, b, c, dt); break;
+        case HALVORSEN: halvorsenStepDouble(x, y, z, a, b, c, dt); break;
+        case AIZAWA: aizawaStepDouble(x, y, z, a, b, c, dt); break;
+        case LUCHEN: luChenStepDouble(x, y, z, a, b, c, dt); break;
+        case GENESIO: genesioStepDouble(x, y, z, a, b, c, dt); break;
+    }
+    return;
+}
+
+static void stepDouble(const StrangeAttractor *model, double *p)
+{
+    // One step in double precision, separations of LYAPUNOV_SEPARATION are lost in float rounding
+    int kind = modelKind(model);
+    if (kind >= 0) stepKind(kind, &p[0], &p[1], &p[2], model->parameters.a, model->parameters.b, model->parameters.c, model->dtime);
+    else {
+        struct Point point = {NULL, p[0], p[1], p[2]}, next;
+        model->attractorFunction(&next, &point, model);
+        p[0] = next.x;
+        p[1] = next.y;
+        p[2] = next.z;
+    }
+    return;
+}
+
+void lyapunovStep(struct Lyapunov *state, const StrangeAttractor *model, int steps)
+{
+    // Benettin's method: a companion starts LYAPUNOV_SEPARATION away from the reference trajectory and every
+    // LYAPUNOV_RENORMALIZE steps the log of its stretch is added up and it is pulled back to that distance
+    double parameters[4] = {model->parameters.a, model->parameters.b, model->parameters.c, model->dtime};
+
+    // * New parameters, the trajectories carry on from where they are but the average restarts
+    if (memcmp(parameters, state->parameters, sizeof(parameters))) {
+        memcpy(state->parameters, parameters, sizeof(parameters));
+        state->sum = 0;
+        state->time = 0;
+        state->steps = 0;
+        state->escaped = 0;
+    }
+
+    // * First use, or the orbit escaped last time, restart from the initial position
+    if (!state->started) {
+        state->reference[0] = model->initialPosition.x;
+        state->reference[1] = model->initialPosition.y;
+        state->reference[2] = model->initialPosition.z;
+        memcpy(state->companion, state->reference, sizeof(state->companion));
+        state->companion[0] += LYAPUNOV_SEPARATION;
+        state->sum = 0;
+        state->time = 0;
+        state->steps = 0;
+        state->started = 1;
+    }
+
+    for (int s = 0; s < steps; s++) {
+        stepDouble(model, state->reference);
+        stepDouble(model, state->companion);
+        if (!isfinite(state->reference[0] + state->reference[1] + state->reference[2])) {
+            state->escaped = 1;
+            state->started = 0;
+            break;
+        }
+        if (++state->steps % LYAPUNOV_RENORMALIZE) continue;
+
+        double delta[3], distance = 0;
+        for (int k = 0; k < 3; k++) {
+            delta[k] = state->companion[k] - state->reference[k];
+            distance += delta[k] * delta[k];
+        }
+        distance = sqrt(distance);
+        if (!(distance > 0) || !isfinite(distance)) {
+            // Collapsed onto the reference or escaped alone, separate it again along x
+            memcpy(state->companion, state->reference, sizeof(state->companion));
+            state->companion[0] += LYAPUNOV_SEPARATION;
+            continue;
+        }
+
+        // * Only average once the companion has turned towards the most expanding direction
+        if (state->steps > LYAPUNOV_TRANSIENT) {
+            state->sum += log(distance / LYAPUNOV_SEPARATION);
+            state->time += LYAPUNOV_RENORMALIZE * model->dtime;
+        }
+        for (int k = 0; k < 3; k++)
+            state->companion[k] = state->reference[k] + delta[k] * (LYAPUNOV_SEPARATION / distance);
+    }
+    return;
+}
+
+double lyapunovExponent(const struct Lyapunov *state)
+{
+    // Per unit of model time, INFINITY when the orbit escapes to infinity and NAN until anything was averaged
+    if (state->escaped) return INFINITY;
+    return state->time > 0 ? state->sum / state->time : NAN;
+}
+
+double attractorLyapunov(AttractorContext *context, int steps)
+{
+    lyapunovStep(&context->lyapunov, &context->model, steps);
+    return lyapunovExponent(&context->lyapunov);
+}
+
+// * BIFURCATION
+
+int attractorMaxima(const StrangeAttractor *model, int coordinate, int transient, int steps, double *maxima, int capacity)
+{
+    // Local maxima of one coordinate along the orbit from the initial position once `transient` steps have passed.
+    // Each one is the vertex of the parabola through the samples around it. Stops early when the orbit escapes
+    int kind = modelKind(model);
+    if (kind < 0) return 0;
+    double p[3] = {model->initialPosition.x, model->initialPosition.y, model->initialPosition.z};
+    double a = model->parameters.a, b = model->parameters.b, c = model->parameters.c, dt = model->dtime;
+    for (int s = 0; s < transient; s++) stepKind(kind, &p[0], &p[1], &p[2], a, b, c, dt);
+    double previous = p[coordinate];
+    stepKind(kind, &p[0], &p[1], &p[2], a, b, c, dt);
+    double current = p[coordinate];
+    int count = 0;
+    for (int s = 0; s < steps && count < capacity && isfinite(current); s++) {
+        stepKind(kind, &p[0], &p[1], &p[2], a, b, c, dt);
+        double next = p[coordinate];
+        if (current > previous && current >= next) {
+            double curvature = previous - 2 * current + next;
+            maxima[count++] = curvature < 0 ? current - (next - previous) * (next - previous) / (8 * curvature) : current;
+        }
+        previous = current;
+        current = next;
+    }
+    return count;
+}
+
+// * POINCARE SECTION
+
+void attractorOrbit(const StrangeAttractor *model, double point[3], int steps, double mean[3])
+{
+    // Advances `point` in double precision, `mean` gets the average position over the steps when not NULL
+    double sum[3] = {0, 0, 0};
+    for (int s = 0; s < steps; s++) {
+        stepDouble(model, point);
+        for (int k = 0; k < 3; k++) sum[k] += point[k];
+    }
+    for (int k = 0; mean && k < 3; k++) mean[k] = steps ? sum[k] / steps : point[k];
+    return;
+}
+
+void attractorTrail(const StrangeAttractor *model, const double start[3], float (*points)[3], int count)
+{
+    // `count` points from `start` with the same float steps as attractorStep(), oldest first
+    struct Point current = {NULL, start[0], start[1], start[2]}, next;
+    for (int i = 0; i < count; i++) {
+        points[i][0] = current.x;
+        points[i][1] = current.y;
+        points[i][2] = current.z;
+        model->attractorFunction(&next, &current, model);
+        current.x = next.x;
+        current.y = next.y;
+        current.z = next.z;
+    }
+    return;
+}
+
+void sectionPlane(struct Section *section, const double normal[3], double offset, int direction)
+{
+    // Normalizes the plane and picks `u` and `v`, `u` is the axis least aligned with the normal projected into the plane.
+    // A plane z = offset gets u = x and v = y
+    double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    int axis = 0;
+    for (int k = 0; k < 3; k++) {
+        section->normal[k] = normal[k] / length;
+        if (fabs(section->normal[k]) < fabs(section->normal[axis])) axis = k;
+    }
+    section->offset = offset / length;
+    section->direction = direction;
+    const double *n = section->normal;
+    double u[3] = {-n[axis] * n[0], -n[axis] * n[1], -n[axis] * n[2]};
+    u[axis] += 1;
+    length = sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+    for (int k = 0; k < 3; k++) section->u[k] = u[k] / length;
+    section->v[0] = n[1] * section->u[2] - n[2] * section->u[1];
+    section->v[1] = n[2] * section->u[0] - n[0] * section->u[2];
+    section->v[2] = n[0] * section->u[1] - n[1] * section->u[0];
+    return;
+}
+
+int attractorSection(const StrangeAttractor *model, const struct Section *section, double point[3], int steps, double (*crossings)[2], int capacity)
+{
+    // Plane crossings along the orbit from `point` as (u, v) coordinates, `point` is left where the steps ended.
+    // The signed distance is tracked per step and a sign change is interpolated linearly along the step,
+    // which is exact for the Euler map. Stops early when `capacity` crossings are found or the orbit escapes
+    int kind = modelKind(model);
+    if (kind < 0) return 0;
+    const double *n = section->normal, *u = section->u, *v = section->v;
+    double a = model->parameters.a, b = model->parameters.b, c = model->parameters.c, dt = model->dtime;
+    double side = n[0] * point[0] + n[1] * point[1] + n[2] * point[2] - section->offset;
+    int count = 0;
+    for (int s = 0; s < steps && count < capacity && isfinite(side); s++) {
+        double last[3] = {point[0], point[1], point[2]};
+        stepKind(kind, &point[0], &point[1], &point[2], a, b, c, dt);
+        double next = n[0] * point[0] + n[1] * point[1] + n[2] * point[2] - section->offset;
+        if ((section->direction >= 0 && side < 0 && next >= 0) || (section->direction <= 0 && side > 0 && next <= 0)) {
+            double t = side / (side - next), q[3];
+            for (int k = 0; k < 3; k++) q[k] = last[k] + t * (point[k] - last[k]);
+            crossings[count][0] = q[0] * u[0] + q[1] * u[1] + q[2] * u[2];
+            crossings[count][1] = q[0] * v[0] + q[1] * v[1] + q[2] * v[2];
+            count++;
+        }
+        side = next;
+    }
+    return count;
+}
+
+// * LYAPUNOV SPECTRUM
+
+static void boundsReset(struct LyapunovBatch *batch, int begin, int end)
+{
+    // Collapses the box of each set onto its current position
+    int n = batch->count;
+    for (int i = begin; i < end; i++) {
+        batch->bounds[i] = batch->bounds[n + i] = batch->x[i];
+        batch->bounds[2 * n + i] = batch->bounds[3 * n + i] = batch->y[i];
+        batch->bounds[4 * n + i] = batch->bounds[5 * n + i] = batch->z[i];
+    }
+    return;
+}
+
+struct LyapunovBatch *lyapunovBatchCreate(const StrangeAttractor *model, const double (*parameters)[3], int count, int interval)
+{
+    // One set per row of `parameters` (a, b, c), everything else comes from `model`.
+    // Arrays are rows of `count` so the loops over sets vectorize
+    int kind = modelKind(model);
+    if (kind < 0 || count <= 0) return NULL;
+    struct LyapunovBatch *batch = memoryCalloc(1, sizeof(struct LyapunovBatch), MEMORY_ENSEMBLE);
+    batch->model = *model;
+    batch->model.trail.head = batch->model.trail.tail = NULL;
+    batch->kind = kind;
+    batch->count = count;
+    batch->interval = interval > 0 ? interval : LYAPUNOV_RENORMALIZE;
+    batch->values = memoryCalloc(25 * (size_t)count, sizeof(double), MEMORY_ENSEMBLE);
+    batch->steps = memoryCalloc(count, sizeof(int), MEMORY_ENSEMBLE);
+    batch->escaped = memoryCalloc(count, sizeof(int), MEMORY_ENSEMBLE);
+    batch->x = batch->values;
+    batch->y = batch->x + count;
+    batch->z = batch->y + count;
+    batch->a = batch->z + count;
+    batch->b = batch->a + count;
+    batch->c = batch->b + count;
+    batch->q = batch->c + count;
+    batch->sums = batch->q + 9 * count;
+    batch->time = batch->sums + 3 * count;
+    batch->bounds = batch->time + count;
+
+    // * Every set starts at the model's initial position with the identity as tangent basis
+    for (int i = 0; i < count; i++) {
+        batch->x[i] = model->initialPosition.x;
+        batch->y[i] = model->initialPosition.y;
+        batch->z[i] = model->initialPosition.z;
+        batch->a[i] = parameters[i][0];
+        batch->b[i] = parameters[i][1];
+        batch->c[i] = parameters[i][2];
+        for (int k = 0; k < 3; k++) batch->q[(4 * k) * count + i] = 1;
+    }
+    boundsReset(batch, 0, count);
+    return batch;
+}
+
+void lyapunovBatchDestroy(struct LyapunovBatch *batch)
+{
+    if (!batch) return;
+    memoryFree(batch->values);
+    memoryFree(batch->steps);
+    memoryFree(batch->escaped);
+    memoryFree(batch);
+    return;
+}
+
+// One step of the state and the tangent vectors of every set, the tangent vectors are the columns of Q
+// and follow the linearized step. The point is seeded with the identity so the dual step returns the Jacobian.
+// The rows of Q share one allocation so the compiler is told they don't overlap
+#define TANGENT_LOOP(step) \
+    _Pragma("GCC ivdep") \
+    for (int i = begin; i < end; i++) { \
+        struct Dual px = {x[i], 1, 0, 0}, py = {y[i], 0, 1, 0}, pz = {z[i], 0, 0, 1}; \
+        step(&px, &py, &pz, a[i], b[i], c[i], dt); \
+        x[i] = px.value; \
+        y[i] = py.value; \
+        z[i] = pz.value; \
+        escaped[i] |= !isfinite(px.value + py.value + pz.value); \
+        lowX[i] = px.value < lowX[i] ? px.value : lowX[i]; \
+        highX[i] = px.value > highX[i] ? px.value : highX[i]; \
+        lowY[i] = py.value < lowY[i] ? py.value : lowY[i]; \
+        highY[i] = py.value > highY[i] ? py.value : highY[i]; \
+        lowZ[i] = pz.value < lowZ[i] ? pz.value : lowZ[i]; \
+        highZ[i] = pz.value > highZ[i] ? pz.value : highZ[i]; \
+        double t[9] = {q0[i], q1[i], q2[i], q3[i], q4[i], q5[i], q6[i], q7[i], q8[i]}; \
+        q0[i] = px.dx * t[0] + px.dy * t[3] + px.dz * t[6]; \
+        q1[i] = px.dx * t[1] + px.dy * t[4] + px.dz * t[7]; \
+        q2[i] = px.dx * t[2] + px.dy * t[5] + px.dz * t[8]; \
+        q3[i] = py.dx * t[0] + py.dy * t[3] + py.dz * t[6]; \
+        q4[i] = py.dx * t[1] + py.dy * t[4] + py.dz * t[7]; \
+        q5[i] = py.dx * t[2] + py.dy * t[5] + py.dz * t[8]; \
+        q6[i] = pz.dx * t[0] + pz.dy * t[3] + pz.dz * t[6]; \
+        q7[i] = pz.dx * t[1] + pz.dy * t[4] + pz.dz * t[7]; \
+        q8[i] = pz.dx * t[2] + pz.dy * t[5] + pz.dz * t[8]; \
+    }
+
+CPU_INLINE void tangentBody(struct LyapunovBatch *batch, int begin, int end)
+{
+    // One step of every set in [begin, end), the model is picked outside the loop so it vectorizes across sets
+    int n = batch->count;
+    double dt = batch->model.dtime;
+    double *restrict x = batch->x, *restrict y = batch->y, *restrict z = batch->z;
+    double *restrict q0 = batch->q, *restrict q1 = q0 + n, *restrict q2 = q1 + n;
+    double *restrict q3 = q2 + n, *restrict q4 = q3 + n, *restrict q5 = q4 + n;
+    double *restrict q6 = q5 + n, *restrict q7 = q6 + n, *restrict q8 = q7 + n;
+    double *restrict lowX = batch->bounds, *restrict highX = lowX + n, *restrict lowY = highX + n;
+    double *restrict highY = lowY + n, *restrict lowZ = highY + n, *restrict highZ = lowZ + n;
+    const double *restrict a = batch->a, *restrict b = batch->b, *restrict c = batch->c;
+    int *restrict escaped = batch->escaped;
+    switch (batch->kind) {
+        case LORENZ: TANGENT_LOOP(lorenzStepTangent) break;
+        case BANLUE: TANGENT_LOOP(banlueStepTangent) break;
+        case HALVORSEN: TANGENT_LOOP(halvorsenStepTangent) break;
+        case AIZAWA: TANGENT_LOOP(aizawaStepTangent) break;
+        case LUCHEN: TANGENT_LOOP(luChenStepTangent) break;
+        case GENESIO: TANGENT_LOOP(genesioStepTangent) break;
+    }
+    return;
+}
+CPU_VARIANTS(tangent, (struct LyapunovBatch *batch, int begin, int end), (batch, begin, end));
+
+static void reorthonormalize(struct LyapunovBatch *batch, int begin, int end, int accumulate)
+{
+    // Modified Gram-Schmidt on the columns of Q, the diagonal of R holds the stretch along each direction
+    int n = batch->count;
+    double *q = batch->q;
+    for (int i = begin; i < end; i++) {
+        if (batch->escaped[i]) continue;
+        for (int j = 0; j < 3; j++) {
+            for (int k = 0; k < j; k++) {
+                double dot = 0;
+                for (int r = 0; r < 3; r++) dot += q[(3 * r + k) * n + i] * q[(3 * r + j) * n + i];
+                for (int r = 0; r < 3; r++) q[(3 * r + j) * n + i] -= dot * q[(3 * r + k) * n + i];
+            }
+            double norm = 0;
+            for (int r = 0; r < 3; r++) norm += q[(3 * r + j) * n + i] * q[(3 * r + j) * n + i];
+            norm = sqrt(norm);
+            for (int r = 0; r < 3; r++) q[(3 * r + j) * n + i] /= norm;
+            if (accumulate) batch->sums[j * n + i] += log(norm);
+        }
+        if (accumulate) batch->time[i] += batch->interval * batch->model.dtime;
+    }
+    return;
+}
+
+void lyapunovBatchRun(struct LyapunovBatch *batch, int begin, int end, int steps)
+{
+    // Advances the sets [begin, end) by `steps`, ranges are independent and can run on different threads.
+    // The first LYAPUNOV_TRANSIENT steps of a set only align the tangent vectors
+    for (int s = 0; s < steps; s++) {
+        tangentVariants[cpuLevel](batch, begin, end);
+        int step = ++batch->steps[begin];
+        for (int i = begin + 1; i < end; i++) batch->steps[i] = step;
+        if (step == LYAPUNOV_TRANSIENT) boundsReset(batch, begin, end);
+        if (step % batch->interval == 0) reorthonormalize(batch, begin, end, step > LYAPUNOV_TRANSIENT);
+    }
+    return;
+}
+
+void lyapunovBatchSpectrum(const struct LyapunovBatch *batch, int set, double spectrum[3])
+{
+    // Exponents per unit of model time in decreasing order, INFINITY for escaped orbits and NAN before any averaging
+    for (int j = 0; j < 3; j++) {
+        if (batch->escaped[set]) spectrum[j] = INFINITY;
+        else spectrum[j] = batch->time[set] > 0 ? batch->sums[j * batch->count + set] / batch->time[set] : NAN;
+    }
+    for (int j = 1; j < 3; j++) {
+        for (int k = j; k > 0 && spectrum[k] > spectrum[k - 1]; k--) {
+            double swap = spectrum[k];
+            spectrum[k] = spectrum[k - 1];
+            spectrum[k - 1] = swap;
+        }
+    }
+    return;
+}
+
+void lyapunovBatchResult(const struct LyapunovBatch *batch, int set, double result[LYAPUNOV_RESULT])
+{
+    // Everything a run gives for one set as it is cached: the spectrum, 1 if the orbit escaped and the bounds
+    lyapunovBatchSpectrum(batch, set, result);
+    result[3] = batch->escaped[set];
+    for (int k = 0; k < 6; k++) result[4 + k] = batch->bounds[k * batch->count + set];
+    return;
+}
+
+static void modelKey(const StrangeAttractor *model, const double parameters[3], enum CacheMethod method, int steps, int interval, struct CacheKey *key)
+{
+    // Everything of `model` a run from its initial position depends on, with `parameters` in place of a, b and c
+    memset(key, 0, sizeof(struct CacheKey));
+    key->method = method;
+    key->model = modelKind(model);
+    key->steps = steps;
+    key->interval = interval;
+    double inputs[7] = {parameters[0], parameters[1], parameters[2], model->dtime, model->initialPosition.x, model->initialPosition.y, model->initialPosition.z};
+    memcpy(key->inputs, inputs, sizeof(inputs));
+    return;
+}
+
+void lyapunovKey(const StrangeAttractor *model, const double parameters[3], int steps, int interval, struct CacheKey *key)
+{
+    // Cache key of a batch run of `steps` for one set, the inputs are exactly what lyapunovBatchCreate() takes from
+    // `model` and the set
+    modelKey(model, parameters, CACHE_SPECTRUM, steps, interval > 0 ? interval : LYAPUNOV_RENORMALIZE, key);
+    return;
+}
+
+void transientKey(const StrangeAttractor *model, int steps, struct CacheKey *key)
+{
+    // Cache key of the attractorOrbit() position after `steps` from the initial position
+    double parameters[3] = {model->parameters.a, model->parameters.b, model->parameters.c};
+    modelKey(model, parameters, CACHE_TRANSIENT, steps, 0, key);
+    return;
+}
+
+double kaplanYorke(const double spectrum[3])
+{
+    // j + (l1 + ... + lj) / |l(j+1)| for the largest j whose partial sum is still non-negative
+    if (!isfinite(spectrum[0] + spectrum[1] + spectrum[2])) return NAN;
+    double sum = 0;
+    int j = 0;
+    while (j < 3 && sum + spectrum[j] >= 0) sum += spectrum[j++];
+    if (j == 0) return 0;
+    if (j == 3) return 3;
+    return j + sum / fabs(spectrum[j]);
+}
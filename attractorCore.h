@@ -0,0 +1,225 @@
+#ifndef ATTRACTOR_CORE_H
+#define ATTRACTOR_CORE_H
+
+// Simulation and camera core, no SDL so it can be linked by benchmarks, tools and other front ends
+
+// * HEADERS
+#include <stddef.h>
+#include <stdint.h>
+#include "cpuDispatch.h"
+#include "resultCache.h"
+
+// * MACRODEFINITIONS
+#define PI (3.14152)
+#define MODEL_COUNT 6
+#define LOD_PIXEL_ERROR (0.5)
+#define VIEW_WIDTH (1280)
+#define VIEW_HEIGHT (780)
+#define LYAPUNOV_SEPARATION (1e-8)
+#define LYAPUNOV_RENORMALIZE (10)
+#define LYAPUNOV_TRANSIENT (1000)
+#define LYAPUNOV_RESULT (10)
+
+// * STRANGE ATTRACTORS
+
+struct Point {
+    struct Point *next;
+    float x;
+    float y;
+    float z;
+};
+struct StrangeAttractor;
+
+// Attractor Function Prototypes
+// Each function advances `point` by one step of the model and writes the result to `newPoint`
+void BanlueAttractor(struct Point *newPoint, const struct Point *point, const struct StrangeAttractor *model);
+void LorenzAttractor(struct Point *newPoint, const struct Point *point, const struct StrangeAttractor *model);
+void HalvorsenAttractor(struct Point *newPoint, const struct Point *point, const struct StrangeAttractor *model);
+void AizawaAttractor(struct Point *newPoint, const struct Point *point, const struct StrangeAttractor *model);
+void LuChenAttractor(struct Point *newPoint, const struct Point *point, const struct StrangeAttractor *model);
+void GenesioAttractor(struct Point *newPoint, const struct Point *point, const struct StrangeAttractor *model);
+
+// Strange Attractor Models
+// The settings of a model, `trail` is managed by the context that owns the model
+typedef struct StrangeAttractor {
+    double dtime;
+    double zoom;
+    void (*attractorFunction)(struct Point*, const struct Point*, const struct StrangeAttractor*);
+    struct {
+        double a;
+        double b;
+        double c;
+        double d;
+        double e;
+    } parameters;
+    struct {
+        double x;
+        double y;
+        double z;
+    } initialPosition;
+    struct {
+        float x;
+        float y;
+        float z;
+    } midpoint;
+    struct {
+        double angle_x;
+        double angle_y;
+        double angle_z;
+        double dangle_x;
+        double dangle_y;
+        double dangle_z;
+    } rotation;
+    struct {
+        struct Point *head;
+        struct Point *tail;
+        int length;
+        int maxLength;
+    } trail;
+} StrangeAttractor;
+
+enum StrangeAttractorType {
+    LORENZ,
+    BANLUE,
+    HALVORSEN,
+    AIZAWA,
+    LUCHEN,
+    GENESIO,
+};
+extern const StrangeAttractor attractorDefaults[MODEL_COUNT];
+extern const char *attractorNames[MODEL_COUNT];
+
+// * CAMERA
+
+struct Frustum {
+    float r;
+    float t;
+    float n;
+    float f;
+};
+
+struct Bounds {
+    double minx;
+    double maxx;
+    double miny;
+    double maxy;
+    double minz;
+    double maxz;
+};
+
+// Trail after the view transform (`view`) and after projection (`data`, `z` is the projected depth)
+// `lod` holds the indices of the vertices that survive decimation
+struct Vertex {
+    float x;
+    float y;
+    float z;
+};
+struct VertexBuffer {
+    struct Vertex *data;
+    struct Vertex *view;
+    int *lod;
+    int count;
+    int lodCount;
+    int capacity;
+};
+
+struct ClipRect {
+    float x;
+    float y;
+    float w;
+    float h;
+};
+
+// * ANALYSIS
+// Running estimate of the largest Lyapunov exponent, see `lyapunovStep()`.
+// Zero initialized it starts from the model's initial position
+struct Lyapunov {
+    double reference[3];
+    double companion[3];
+    double parameters[4];
+    double sum;
+    double time;
+    int steps;
+    int started;
+    int escaped;
+};
+
+// Plane normal . p = offset with unit `normal`, `u` and `v` span the plane. Crossings count along the normal
+// for `direction` 1, against it for -1 and both ways for 0, see `attractorSection()`
+struct Section {
+    double normal[3];
+    double offset;
+    int direction;
+    double u[3];
+    double v[3];
+};
+
+// Full spectrum of many parameter sets of one model at once, see `lyapunovBatchRun()`.
+// Per set values are stored as rows of `count`: `q` holds the 3x3 tangent basis row major, `sums` the log stretches
+// and `bounds` the box the orbit stayed in after the transient, min x, max x, min y, max y, min z, max z
+struct LyapunovBatch {
+    StrangeAttractor model;
+    int kind;
+    int count;
+    int interval;
+    double *values;
+    double *x;
+    double *y;
+    double *z;
+    double *a;
+    double *b;
+    double *c;
+    double *q;
+    double *sums;
+    double *time;
+    double *bounds;
+    int *steps;
+    int *escaped;
+};
+
+// * CONTEXT
+// Current model, its trail, the camera and the projected trail
+typedef struct AttractorContext AttractorContext;
+
+// * FUNCTION PROTOTYPES
+AttractorContext *attractorCreate(enum StrangeAttractorType type);
+void attractorDestroy(AttractorContext *context);
+void attractorSetModel(AttractorContext *context, enum StrangeAttractorType type);
+void attractorResetTrail(AttractorContext *context);
+void attractorLoadTrail(AttractorContext *context, const float (*points)[3], int count);
+void freeTrail(StrangeAttractor *model);
+enum StrangeAttractorType attractorType(const AttractorContext *context);
+StrangeAttractor *attractorModel(AttractorContext *context);
+const struct Frustum *attractorFrustum(const AttractorContext *context);
+struct VertexBuffer *attractorVertices(AttractorContext *context);
+const struct Bounds *attractorBounds(const AttractorContext *context);
+void attractorStep(AttractorContext *context);
+void attractorIntegrate(const StrangeAttractor *model, float *x, float *y, float *z, int count, int steps);
+void attractorIntegrateDouble(const StrangeAttractor *model, double *x, double *y, double *z, int count, int steps);
+int attractorTransform(AttractorContext *context);
+int attractorGather(AttractorContext *context);
+void attractorProject(AttractorContext *context, int begin, int end);
+void attractorDecimate(AttractorContext *context, float scale);
+void lyapunovStep(struct Lyapunov *state, const StrangeAttractor *model, int steps);
+double lyapunovExponent(const struct Lyapunov *state);
+double attractorLyapunov(AttractorContext *context, int steps);
+void attractorOrbit(const StrangeAttractor *model, double point[3], int steps, double mean[3]);
+void attractorTrail(const StrangeAttractor *model, const double start[3], float (*points)[3], int count);
+void transientKey(const StrangeAttractor *model, int steps, struct CacheKey *key);
+void sectionPlane(struct Section *section, const double normal[3], double offset, int direction);
+int attractorSection(const StrangeAttractor *model, const struct Section *section, double point[3], int steps, double (*crossings)[2], int capacity);
+int attractorMaxima(const StrangeAttractor *model, int coordinate, int transient, int steps, double *maxima, int capacity);
+struct LyapunovBatch *lyapunovBatchCreate(const StrangeAttractor *model, const double (*parameters)[3], int count, int interval);
+void lyapunovBatchDestroy(struct LyapunovBatch *batch);
+void lyapunovBatchRun(struct LyapunovBatch *batch, int begin, int end, int steps);
+void lyapunovBatchSpectrum(const struct LyapunovBatch *batch, int set, double spectrum[3]);
+double kaplanYorke(const double spectrum[3]);
+void lyapunovBatchResult(const struct LyapunovBatch *batch, int set, double result[LYAPUNOV_RESULT]);
+void lyapunovKey(const StrangeAttractor *model, const double parameters[3], int steps, int interval, struct CacheKey *key);
+int clipSegment(const struct Frustum *frustum, const struct Vertex *view_0, const struct Vertex *view_1, struct Vertex *p0, struct Vertex *p1, const struct ClipRect *clip);
+void project(const struct Frustum *frustum, float x, float y, float z, float *xp, float *yp, float *zp);
+void rotateX(float *x, float *y, float *z, float angle);
+void rotateY(float *x, float *y, float *z, float angle);
+void rotateZ(float *x, float *y, float *z, float angle);
+
+#endif
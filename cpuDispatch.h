@@ -0,0 +1,60 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+// Instruction set variants of the hot kernels, the level is picked once at startup by the front end
+
+// * HEADERS
+#if defined(__SSE__) || defined(__x86_64__)
+    #include <xmmintrin.h>
+#endif
+
+// * CPU LEVELS
+enum CpuLevel {
+    CPU_GENERIC,
+    CPU_SSE2,
+    CPU_AVX,
+    CPU_AVX2,
+    CPU_AVX512,
+    CPU_LEVELS
+};
+extern enum CpuLevel cpuLevel;
+extern const char *cpuLevelNames[CPU_LEVELS];
+
+// * VARIANTS
+// A kernel is written once as `nameBody`, an always inline function, and CPU_VARIANTS wraps it in one function
+// per level. Each wrapper is compiled for its own instruction set so the compiler vectorizes every copy separately,
+// and `nameVariants[cpuLevel](...)` calls the one for this machine.
+// Contraction into FMA is off under -std=c99, so every level gives the same results
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #define CPU_TARGET_SSE2 __attribute__((target("sse2")))
+    #define CPU_TARGET_AVX __attribute__((target("avx")))
+    #define CPU_TARGET_AVX2 __attribute__((target("avx2")))
+    #define CPU_TARGET_AVX512 __attribute__((target("avx512f,avx2")))
+#else
+    #define CPU_TARGET_SSE2
+    #define CPU_TARGET_AVX
+    #define CPU_TARGET_AVX2
+    #define CPU_TARGET_AVX512
+#endif
+#define CPU_INLINE static inline __attribute__((always_inline))
+
+// * DENORMALS
+// Orbits that settle on a fixed point at the origin underflow into denormals, which x86 handles in microcode at a
+// fraction of the normal speed. Nothing here needs them, so every thread that runs kernels flushes them to zero
+CPU_INLINE void cpuFlushDenormals()
+{
+    #if defined(__SSE__) || defined(__x86_64__)
+        _mm_setcsr(_mm_getcsr() | 0x8040); // Flush to zero and denormals are zero
+    #endif
+    return;
+}
+
+#define CPU_VARIANTS(name, params, args) \
+    static void name##Generic params { name##Body args; } \
+    static CPU_TARGET_SSE2 void name##Sse2 params { name##Body args; } \
+    static CPU_TARGET_AVX void name##Avx params { name##Body args; } \
+    static CPU_TARGET_AVX2 void name##Avx2 params { name##Body args; } \
+    static CPU_TARGET_AVX512 void name##Avx512 params { name##Body args; } \
+    static void (*const name##Variants[CPU_LEVELS]) params = {name##Generic, name##Sse2, name##Avx, name##Avx2, name##Avx512}
+
+#endif
@@ -0,0 +1,240 @@
+#include <stdint.h>
+#include "jobSystem.h"
+#include "cpuDispatch.h"
+#include "memoryTracker.h"
+
+struct JobSystem jobs;
+
+// * QUEUES
+
+static void jobExecute(int index, struct Job *job);
+
+static void jobPush(int index, const struct Job *job)
+{
+    // A full queue, or no pool at all, runs the job right away on this thread
+    struct JobQueue *queue = jobs.queues ? &jobs.queues[index] : NULL;
+    if (queue) SDL_AtomicLock(&queue->lock);
+    if (!queue || queue->bottom - queue->top == JOB_QUEUE_SIZE) {
+        if (queue) SDL_AtomicUnlock(&queue->lock);
+        struct Job inline_job = *job;
+        jobExecute(index, &inline_job);
+        return;
+    }
+    queue->jobs[queue->bottom++ % JOB_QUEUE_SIZE] = *job;
+    SDL_AtomicUnlock(&queue->lock);
+
+    // Sleepers recheck the queues after announcing themselves, so a push can't be missed
+    if (SDL_AtomicGet(&jobs.sleeping)) SDL_SemPost(jobs.wake);
+    return;
+}
+
+static int jobTake(int index, struct Job *job)
+{
+    // Newest job of our own queue first, it is the one most likely still in cache
+    struct JobQueue *queue = &jobs.queues[index];
+    SDL_AtomicLock(&queue->lock);
+    if (queue->bottom > queue->top) {
+        *job = queue->jobs[--queue->bottom % JOB_QUEUE_SIZE];
+        SDL_AtomicUnlock(&queue->lock);
+        return 1;
+    }
+    SDL_AtomicUnlock(&queue->lock);
+
+    // * Steal the oldest job of another queue, those are the largest ranges
+    for (int k = 1; k < jobs.count; k++) {
+        struct JobQueue *victim = &jobs.queues[(index + k) % jobs.count];
+        SDL_AtomicLock(&victim->lock);
+        if (victim->bottom > victim->top) {
+            *job = victim->jobs[victim->top++ % JOB_QUEUE_SIZE];
+            SDL_AtomicUnlock(&victim->lock);
+            return 1;
+        }
+        SDL_AtomicUnlock(&victim->lock);
+    }
+    return 0;
+}
+
+static void jobDone(int index, struct JobGroup *group)
+{
+    // The count drops under the group's lock, so a waiter that saw zero and then took the lock
+    // knows nobody touches the group anymore
+    SDL_AtomicLock(&group->lock);
+    struct Job *released = NULL;
+    if (SDL_AtomicDecRef(&group->pending)) {
+        released = group->continuations;
+        group->continuations = NULL;
+    }
+    SDL_AtomicUnlock(&group->lock);
+
+    // * Dependencies are met, queue the jobs that waited on this group
+    while (released) {
+        struct Job *next = released->next;
+        jobPush(index, released);
+        memoryFree(released);
+        released = next;
+    }
+    return;
+}
+
+static void jobExecute(int index, struct Job *job)
+{
+    // Ranges longer than the grain are halved and the upper half is pushed, idle threads steal those
+    while (job->end - job->begin > job->grain) {
+        struct Job upper = *job;
+        upper.begin = job->begin + (job->end - job->begin) / 2;
+        job->end = upper.begin;
+        SDL_AtomicIncRef(&job->group->pending);
+        jobPush(index, &upper);
+    }
+    if (jobs.trace) jobs.trace(index, job->name, 'B');
+    job->function(job->data, job->begin, job->end);
+    if (jobs.trace) jobs.trace(index, job->name, 'E');
+    jobDone(index, job->group);
+    return;
+}
+
+static int jobWorker(void *data)
+{
+    int index = (intptr_t)data;
+    SDL_TLSSet(jobs.index, data, NULL);
+    cpuFlushDenormals();
+    while (SDL_AtomicGet(&jobs.running)) {
+        struct Job job;
+        if (jobTake(index, &job)) {
+            jobExecute(index, &job);
+            continue;
+        }
+
+        // * Nothing to do, announce we are going to sleep and look once more before waiting
+        SDL_AtomicIncRef(&jobs.sleeping);
+        if (jobTake(index, &job)) {
+            SDL_AtomicAdd(&jobs.sleeping, -1);
+            jobExecute(index, &job);
+            continue;
+        }
+        SDL_SemWaitTimeout(jobs.wake, 10);
+        SDL_AtomicAdd(&jobs.sleeping, -1);
+    }
+    return 0;
+}
+
+// * POOL
+
+void initializeJobs(int threads)
+{
+    // `threads` counts the main thread, 0 uses every core
+    if (threads <= 0) threads = SDL_GetCPUCount();
+    jobs.count = SDL_clamp(threads, 1, JOB_MAX_THREADS);
+    jobs.queues = memoryCalloc(jobs.count, sizeof(struct JobQueue), MEMORY_JOBS);
+    jobs.wake = SDL_CreateSemaphore(0);
+    jobs.index = SDL_TLSCreate();
+    SDL_AtomicSet(&jobs.running, 1);
+    SDL_AtomicSet(&jobs.sleeping, 0);
+    for (int t = 1; t < jobs.count; t++)
+        jobs.threads[t] = SDL_CreateThread(jobWorker, "job worker", (void *)(intptr_t)t);
+    return;
+}
+
+void freeJobs()
+{
+    if (!jobs.queues) return;
+    SDL_AtomicSet(&jobs.running, 0);
+    for (int t = 1; t < jobs.count; t++) SDL_SemPost(jobs.wake);
+    for (int t = 1; t < jobs.count; t++) {
+        SDL_WaitThread(jobs.threads[t], NULL);
+        jobs.threads[t] = NULL;
+    }
+    SDL_DestroySemaphore(jobs.wake);
+    memoryFree(jobs.queues);
+    jobs.queues = NULL;
+    jobs.count = 0;
+    return;
+}
+
+int jobThreadIndex()
+{
+    // 0 on the main thread and on threads outside the pool
+    if (!jobs.queues) return 0;
+    return (intptr_t)SDL_TLSGet(jobs.index);
+}
+
+// * SUBMITTING AND WAITING
+
+void jobRun(struct JobGroup *group, JobFunction function, const char *name, void *data, int begin, int end)
+{
+    // One job for the whole range, it is never split
+    jobParallelFor(group, function, name, data, begin, end, end - begin);
+    return;
+}
+
+void jobParallelFor(struct JobGroup *group, JobFunction function, const char *name, void *data, int begin, int end, int grain)
+{
+    // Runs `function` over [begin, end) in pieces of at most `grain`, the range is split as threads go idle
+    if (end <= begin) return;
+    struct Job job = {function, name, data, begin, end, SDL_max(grain, 1), group, NULL};
+    SDL_AtomicIncRef(&group->pending);
+    jobPush(jobThreadIndex(), &job);
+    return;
+}
+
+void jobAfter(struct JobGroup *dependency, struct JobGroup *group, JobFunction function, const char *name, void *data, int begin, int end, int grain)
+{
+    // Like jobParallelFor() but the job only starts once every job of `dependency` is done
+    if (end <= begin) return;
+    struct Job job = {function, name, data, begin, end, SDL_max(grain, 1), group, NULL};
+    SDL_AtomicIncRef(&group->pending);
+    SDL_AtomicLock(&dependency->lock);
+    if (SDL_AtomicGet(&dependency->pending)) {
+        struct Job *held = memoryAlloc(sizeof(struct Job), MEMORY_JOBS);
+        *held = job;
+        held->next = dependency->continuations;
+        dependency->continuations = held;
+        SDL_AtomicUnlock(&dependency->lock);
+        return;
+    }
+    SDL_AtomicUnlock(&dependency->lock);
+    jobPush(jobThreadIndex(), &job);
+    return;
+}
+
+void jobWait(struct JobGroup *group)
+{
+    // The waiting thread runs jobs itself until the group is done, including other groups' jobs.
+    // With nothing to take it spins for a while, then sleeps in short steps like the workers so a long job
+    // doesn't keep a second core busy. Pushes wake it early, the end of the group is seen within a millisecond
+    int index = jobThreadIndex(), idle = 0;
+    while (SDL_AtomicGet(&group->pending)) {
+        struct Job job;
+        if (jobs.queues && jobTake(index, &job)) {
+            jobExecute(index, &job);
+            idle = 0;
+        }
+        else if (!jobs.queues || ++idle < JOB_SPINS) SDL_CPUPauseInstruction();
+        else {
+            // Announce the sleep and look once more, as the workers do
+            SDL_AtomicIncRef(&jobs.sleeping);
+            int taken = jobTake(index, &job);
+            if (!taken && SDL_AtomicGet(&group->pending)) SDL_SemWaitTimeout(jobs.wake, 1);
+            SDL_AtomicAdd(&jobs.sleeping, -1);
+            if (taken) {
+                jobExecute(index, &job);
+                idle = 0;
+            }
+        }
+    }
+
+    // The last job may still be releasing the group's lock
+    SDL_AtomicLock(&group->lock);
+    SDL_AtomicUnlock(&group->lock);
+    return;
+}
+
+int jobHelp()
+{
+    // Runs one queued job on this thread if there is any, for loops that poll a group instead of waiting on it
+    struct Job job;
+    int index = jobThreadIndex();
+    if (!jobs.queues || !jobTake(index, &job)) return 0;
+    jobExecute(index, &job);
+    return 1;
+}
@@ -0,0 +1,72 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+// Work-stealing thread pool, every parallel part of the program submits to it so they share the cores
+
+// * HEADERS
+#include <SDL.h>
+
+// * MACRODEFINITIONS
+#define JOB_QUEUE_SIZE (4096)
+#define JOB_MAX_THREADS (64)
+#define JOB_SPINS (1000) // Failed steals before a waiting thread sleeps instead of spinning
+
+// * JOBS
+// A job runs `function` over the range [begin, end) of `data`, `name` labels it for tracing
+typedef void (*JobFunction)(void *data, int begin, int end);
+
+// Called with 'B' and 'E' around every job on thread `index` when set
+typedef void (*JobTrace)(int index, const char *name, char phase);
+
+struct JobGroup;
+struct Job {
+    JobFunction function;
+    const char *name;
+    void *data;
+    int begin;
+    int end;
+    int grain;
+    struct JobGroup *group;
+    struct Job *next;
+};
+
+// Every job belongs to a group and waiting on the group waits for all of its jobs.
+// Jobs added with `jobAfter()` are held in `continuations` until the group they depend on is done
+struct JobGroup {
+    SDL_atomic_t pending;
+    SDL_SpinLock lock;
+    struct Job *continuations;
+};
+
+// One deque per thread, the owner pushes and pops at the bottom and thieves take from the top.
+// Queue 0 belongs to the main thread and any other thread outside the pool
+struct JobQueue {
+    SDL_SpinLock lock;
+    int top;
+    int bottom;
+    struct Job jobs[JOB_QUEUE_SIZE];
+};
+
+struct JobSystem {
+    SDL_Thread *threads[JOB_MAX_THREADS];
+    struct JobQueue *queues;
+    int count;
+    SDL_atomic_t running;
+    SDL_atomic_t sleeping;
+    SDL_sem *wake;
+    SDL_TLSID index;
+    JobTrace trace;
+};
+extern struct JobSystem jobs;
+
+// * FUNCTION PROTOTYPES
+void initializeJobs(int threads);
+void freeJobs();
+void jobRun(struct JobGroup *group, JobFunction function, const char *name, void *data, int begin, int end);
+void jobParallelFor(struct JobGroup *group, JobFunction function, const char *name, void *data, int begin, int end, int grain);
+void jobAfter(struct JobGroup *dependency, struct JobGroup *group, JobFunction function, const char *name, void *data, int begin, int end, int grain);
+void jobWait(struct JobGroup *group);
+int jobHelp();
+int jobThreadIndex();
+
+#endif
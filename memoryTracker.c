@@ -0,0 +1,94 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#elif defined(__linux__)
+    #include <sys/resource.h>
+#endif
+#include "memoryTracker.h"
+
+// Every allocation carries a small header with its size and subsystem so frees can be accounted for
+struct MemoryHeader {
+    size_t size;
+    size_t subsystem; // Two words keep the data after the header as aligned as malloc's
+};
+
+const char *memorySubsystemNames[MEMORY_SUBSYSTEMS] = {"trail", "vertices", "framebuffers", "ensemble", "output", "trace", "bench", "jobs", "cache"};
+struct Memory memory;
+
+// Counters are shared by every thread, a spinlock keeps the few updates consistent
+#define MEMORY_LOCK() while (__sync_lock_test_and_set(&memory.lock, 1)) {}
+#define MEMORY_UNLOCK() __sync_lock_release(&memory.lock)
+
+void *memoryAlloc(size_t size, enum MemorySubsystem subsystem)
+{
+    struct MemoryHeader *header = malloc(sizeof(struct MemoryHeader) + size);
+    if (!header) return NULL;
+    header->size = size;
+    header->subsystem = subsystem;
+    MEMORY_LOCK();
+    memory.allocations++;
+    memory.live[subsystem] += size;
+    memory.total += size;
+    if (memory.total > memory.peak) memory.peak = memory.total;
+    MEMORY_UNLOCK();
+    return header + 1;
+}
+
+void *memoryCalloc(size_t count, size_t size, enum MemorySubsystem subsystem)
+{
+    void *data = memoryAlloc(count * size, subsystem);
+    if (data) memset(data, 0, count * size);
+    return data;
+}
+
+void *memoryRealloc(void *data, size_t size, enum MemorySubsystem subsystem)
+{
+    if (!data) return memoryAlloc(size, subsystem);
+    struct MemoryHeader *header = (struct MemoryHeader *)data - 1;
+    size_t old_size = header->size;
+    header = realloc(header, sizeof(struct MemoryHeader) + size);
+    if (!header) return NULL;
+    header->size = size;
+    MEMORY_LOCK();
+    memory.allocations++;
+    memory.live[header->subsystem] += size - old_size;
+    memory.total += size - old_size;
+    if (memory.total > memory.peak) memory.peak = memory.total;
+    MEMORY_UNLOCK();
+    return header + 1;
+}
+
+void memoryFree(void *data)
+{
+    if (!data) return;
+    struct MemoryHeader *header = (struct MemoryHeader *)data - 1;
+    MEMORY_LOCK();
+    memory.live[header->subsystem] -= header->size;
+    memory.total -= header->size;
+    MEMORY_UNLOCK();
+    free(header);
+    return;
+}
+
+size_t peakResidentBytes()
+{
+    #ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return counters.PeakWorkingSetSize;
+    #elif defined(__linux__)
+        struct rusage usage;
+        if (!getrusage(RUSAGE_SELF, &usage)) return (size_t)usage.ru_maxrss * 1024;
+    #endif
+    return 0;
+}
+
+void printMemorySummary()
+{
+    fprintf(stderr, "\nMemory: %llu allocations, peak %.2f MiB tracked, peak RSS %.2f MiB\n", (unsigned long long)memory.allocations, memory.peak / 1048576.0, peakResidentBytes() / 1048576.0);
+    for (int subsystem = 0; subsystem < MEMORY_SUBSYSTEMS; subsystem++)
+        fprintf(stderr, "  %-12s %10.2f MiB live\n", memorySubsystemNames[subsystem], memory.live[subsystem] / 1048576.0);
+    return;
+}
@@ -0,0 +1,41 @@
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+// * HEADERS
+#include <stddef.h>
+#include <stdint.h>
+
+// * MEMORY
+// Live bytes per subsystem, see `memoryAlloc()`
+enum MemorySubsystem {
+    MEMORY_TRAIL,
+    MEMORY_VERTICES,
+    MEMORY_FRAMEBUFFERS,
+    MEMORY_ENSEMBLE,
+    MEMORY_OUTPUT,
+    MEMORY_TRACE,
+    MEMORY_BENCH,
+    MEMORY_JOBS,
+    MEMORY_CACHE,
+    MEMORY_SUBSYSTEMS
+};
+extern const char *memorySubsystemNames[MEMORY_SUBSYSTEMS];
+
+struct Memory {
+    volatile int lock;
+    uint64_t allocations;
+    size_t live[MEMORY_SUBSYSTEMS];
+    size_t total;
+    size_t peak;
+};
+extern struct Memory memory;
+
+// * FUNCTION PROTOTYPES
+void *memoryAlloc(size_t size, enum MemorySubsystem subsystem);
+void *memoryCalloc(size_t count, size_t size, enum MemorySubsystem subsystem);
+void *memoryRealloc(void *data, size_t size, enum MemorySubsystem subsystem);
+void memoryFree(void *data);
+size_t peakResidentBytes();
+void printMemorySummary();
+
+#endif
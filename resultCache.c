@@ -0,0 +1,246 @@
+#ifndef _WIN32
+    #define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+#include "resultCache.h"
+#include "memoryTracker.h"
+
+#define CACHE_LOCK(cache) while (__sync_lock_test_and_set(&(cache)->lock, 1)) {}
+#define CACHE_UNLOCK(cache) __sync_lock_release(&(cache)->lock)
+
+static const char cacheMagic[8] = "SACACHE";
+
+// * HASHING
+
+uint64_t hashBytes(uint64_t hash, const void *data, size_t length)
+{
+    // 64 bit FNV-1a, start from CACHE_HASH_SEED
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < length; i++) hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+static uint64_t keyHash(const struct CacheKey *key)
+{
+    // 0 marks empty slots
+    uint64_t hash = hashBytes(CACHE_HASH_SEED, key, sizeof(struct CacheKey));
+    return hash ? hash : 1;
+}
+
+// * FRONT
+
+static int frontFind(const struct ResultCache *cache, uint64_t hash, const struct CacheKey *key)
+{
+    for (int n = cache->buckets[hash % (2 * CACHE_FRONT)]; n >= 0; n = cache->nodes[n].chain) {
+        const struct CacheRecord *record = &cache->nodes[n].record;
+        if (record->hash == hash && !memcmp(&record->key, key, sizeof(struct CacheKey))) return n;
+    }
+    return -1;
+}
+
+static void frontUnlink(struct ResultCache *cache, int n)
+{
+    struct CacheNode *node = &cache->nodes[n];
+    if (node->previous >= 0) cache->nodes[node->previous].next = node->next;
+    else cache->newest = node->next;
+    if (node->next >= 0) cache->nodes[node->next].previous = node->previous;
+    else cache->oldest = node->previous;
+    return;
+}
+
+static void frontTouch(struct ResultCache *cache, int n)
+{
+    // Moves node `n` to the newest end of the LRU list
+    if (cache->newest == n) return;
+    frontUnlink(cache, n);
+    cache->nodes[n].previous = -1;
+    cache->nodes[n].next = cache->newest;
+    cache->nodes[cache->newest].previous = n;
+    cache->newest = n;
+    return;
+}
+
+static void frontInsert(struct ResultCache *cache, const struct CacheRecord *record)
+{
+    // A new record takes a free node or evicts the least recently used one
+    int n = frontFind(cache, record->hash, &record->key);
+    if (n >= 0) {
+        cache->nodes[n].record = *record;
+        frontTouch(cache, n);
+        return;
+    }
+    if (cache->used < CACHE_FRONT) {
+        n = cache->used++;
+        cache->nodes[n].previous = -1;
+        cache->nodes[n].next = cache->newest;
+        if (cache->newest >= 0) cache->nodes[cache->newest].previous = n;
+        else cache->oldest = n;
+        cache->newest = n;
+    }
+    else {
+        n = cache->oldest;
+        int *link = &cache->buckets[cache->nodes[n].record.hash % (2 * CACHE_FRONT)];
+        while (*link != n) link = &cache->nodes[*link].chain;
+        *link = cache->nodes[n].chain;
+        frontTouch(cache, n);
+    }
+    cache->nodes[n].record = *record;
+    int *bucket = &cache->buckets[record->hash % (2 * CACHE_FRONT)];
+    cache->nodes[n].chain = *bucket;
+    *bucket = n;
+    return;
+}
+
+// * STORE
+
+struct ResultCache *cacheOpen(const char *path)
+{
+    // Maps `path`, creating it if needed. A file from another version or capacity starts over empty, and NULL means
+    // the file can't be used, e.g. when another process has it open
+    size_t size = sizeof(struct CacheHeader) + (size_t)CACHE_CAPACITY * sizeof(struct CacheRecord);
+    #ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return NULL;
+        HANDLE fileMapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+        void *mapping = fileMapping ? MapViewOfFile(fileMapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : NULL;
+        if (!mapping) {
+            if (fileMapping) CloseHandle(fileMapping);
+            CloseHandle(file);
+            return NULL;
+        }
+    #else
+        // A write lock on the whole file keeps other processes out, a new or resized file is truncated to zeros
+        int file = open(path, O_RDWR | O_CREAT, 0644);
+        if (file < 0) return NULL;
+        struct flock exclusive = {.l_type = F_WRLCK, .l_whence = SEEK_SET};
+        struct stat status;
+        int failed = fcntl(file, F_SETLK, &exclusive) || fstat(file, &status);
+        if (!failed && status.st_size != (off_t)size) failed = ftruncate(file, 0) || ftruncate(file, size);
+        void *mapping = failed ? MAP_FAILED : mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        if (mapping == MAP_FAILED) {
+            close(file);
+            return NULL;
+        }
+        int fileMapping = -1;
+    #endif
+
+    // * The header must match or the records are cleared
+    struct ResultCache *cache = memoryCalloc(1, sizeof(struct ResultCache), MEMORY_CACHE);
+    cache->mapping = mapping;
+    cache->size = size;
+    cache->file = (intptr_t)file;
+    cache->fileMapping = (intptr_t)fileMapping;
+    cache->header = mapping;
+    cache->records = (struct CacheRecord *)(cache->header + 1);
+    struct CacheHeader *header = cache->header;
+    if (memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) || header->version != CACHE_VERSION || header->capacity != CACHE_CAPACITY) {
+        if (header->magic[0]) memset(cache->records, 0, (size_t)CACHE_CAPACITY * sizeof(struct CacheRecord));
+        memcpy(header->magic, cacheMagic, sizeof(cacheMagic));
+        header->version = CACHE_VERSION;
+        header->capacity = CACHE_CAPACITY;
+        header->records = 0;
+    }
+
+    // * Empty front
+    cache->nodes = memoryAlloc(CACHE_FRONT * sizeof(struct CacheNode), MEMORY_CACHE);
+    cache->buckets = memoryAlloc(2 * CACHE_FRONT * sizeof(int), MEMORY_CACHE);
+    for (int i = 0; i < 2 * CACHE_FRONT; i++) cache->buckets[i] = -1;
+    cache->newest = cache->oldest = -1;
+    return cache;
+}
+
+void cacheClose(struct ResultCache *cache)
+{
+    if (!cache) return;
+    #ifdef _WIN32
+        UnmapViewOfFile(cache->mapping);
+        CloseHandle((HANDLE)cache->fileMapping);
+        CloseHandle((HANDLE)cache->file);
+    #else
+        munmap(cache->mapping, cache->size);
+        close((int)cache->file);
+    #endif
+    memoryFree(cache->nodes);
+    memoryFree(cache->buckets);
+    memoryFree(cache);
+    return;
+}
+
+static struct CacheRecord *storeFind(struct ResultCache *cache, uint64_t hash, const struct CacheKey *key, int *empty)
+{
+    // The record of `key`, or NULL and the first empty slot of its probe window in `empty`, -1 if the window is full
+    *empty = -1;
+    for (int probe = 0; probe < CACHE_PROBES; probe++) {
+        int slot = (hash + probe) % CACHE_CAPACITY;
+        struct CacheRecord *record = &cache->records[slot];
+        if (!record->hash) {
+            *empty = slot;
+            return NULL;
+        }
+        if (record->hash == hash && !memcmp(&record->key, key, sizeof(struct CacheKey))) return record;
+    }
+    return NULL;
+}
+
+int cacheLookup(struct ResultCache *cache, const struct CacheKey *key, double values[CACHE_VALUES])
+{
+    // 1 and the stored values when `key` was computed before, records found in the store move into the front
+    if (!cache) return 0;
+    uint64_t hash = keyHash(key);
+    int empty, found = 1;
+    CACHE_LOCK(cache);
+    int n = frontFind(cache, hash, key);
+    if (n >= 0) {
+        frontTouch(cache, n);
+        memcpy(values, cache->nodes[n].record.values, sizeof(cache->nodes[n].record.values));
+        cache->frontHits++;
+    }
+    else {
+        const struct CacheRecord *record = storeFind(cache, hash, key, &empty);
+        if (record) {
+            memcpy(values, record->values, sizeof(record->values));
+            frontInsert(cache, record);
+        }
+        else found = 0;
+    }
+    if (found) cache->hits++;
+    else cache->misses++;
+    CACHE_UNLOCK(cache);
+    return found;
+}
+
+void cacheStore(struct ResultCache *cache, const struct CacheKey *key, const double *values, int count)
+{
+    // The first `count` values, the rest are zero. When the probe window is full the high bits of the hash pick the
+    // record it replaces
+    if (!cache) return;
+    struct CacheRecord record = {keyHash(key), *key, {0}};
+    memcpy(record.values, values, (count < CACHE_VALUES ? count : CACHE_VALUES) * sizeof(double));
+    int empty;
+    CACHE_LOCK(cache);
+    struct CacheRecord *slot = storeFind(cache, record.hash, key, &empty);
+    if (!slot && empty >= 0) {
+        slot = &cache->records[empty];
+        cache->header->records++;
+    }
+    if (!slot) slot = &cache->records[(record.hash + (record.hash >> 32) % CACHE_PROBES) % CACHE_CAPACITY];
+    slot->hash = 0;
+    __sync_synchronize();
+    slot->key = record.key;
+    memcpy(slot->values, record.values, sizeof(record.values));
+    __sync_synchronize();
+    slot->hash = record.hash;
+    frontInsert(cache, &record);
+    CACHE_UNLOCK(cache);
+    return;
+}
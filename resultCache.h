@@ -0,0 +1,85 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+// Persistent results of expensive per-parameter computations, addressed by a hash of everything that went into them.
+// No SDL, it is part of the headless core
+
+// * HEADERS
+#include <stddef.h>
+#include <stdint.h>
+
+// * MACRODEFINITIONS
+#define CACHE_VERSION (1) // Bump when a cached computation changes its results
+#define CACHE_CAPACITY (1 << 17)
+#define CACHE_FRONT (4096)
+#define CACHE_PROBES (8)
+#define CACHE_VALUES (12)
+#define CACHE_HASH_SEED (14695981039346656037ull)
+
+// * KEYS AND RECORDS
+// What was computed (`method`), for which model and how long, and every input that changes the result.
+// Keys are compared byte for byte, so they have no padding and unused inputs are zero
+enum CacheMethod {
+    CACHE_SPECTRUM = 1,
+    CACHE_TRANSIENT
+};
+
+struct CacheKey {
+    uint32_t method;
+    uint32_t model;
+    uint32_t steps;
+    uint32_t interval;
+    double inputs[8];
+};
+
+// A slot of the store, `hash` is 0 for an empty slot and written last so a torn record reads as empty
+struct CacheRecord {
+    uint64_t hash;
+    struct CacheKey key;
+    double values[CACHE_VALUES];
+};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;
+    uint64_t records;
+};
+
+// * CACHE
+// The store is a file mapped into memory, an open addressed table of CACHE_CAPACITY records probed CACHE_PROBES slots
+// from the hash. The front is a chained hash table of the CACHE_FRONT most recently used records with an LRU list
+// through `previous` and `next`, so repeated queries don't touch the mapping
+struct CacheNode {
+    struct CacheRecord record;
+    int previous;
+    int next;
+    int chain;
+};
+
+struct ResultCache {
+    volatile int lock;
+    struct CacheHeader *header;
+    struct CacheRecord *records;
+    void *mapping;
+    size_t size;
+    intptr_t file;
+    intptr_t fileMapping;
+    struct CacheNode *nodes;
+    int *buckets;
+    int used;
+    int newest;
+    int oldest;
+    uint64_t hits;
+    uint64_t frontHits;
+    uint64_t misses;
+};
+
+// * FUNCTION PROTOTYPES
+uint64_t hashBytes(uint64_t hash, const void *data, size_t length);
+struct ResultCache *cacheOpen(const char *path);
+void cacheClose(struct ResultCache *cache);
+int cacheLookup(struct ResultCache *cache, const struct CacheKey *key, double values[CACHE_VALUES]);
+void cacheStore(struct ResultCache *cache, const struct CacheKey *key, const double *values, int count);
+
+#endif
@@ -3,168 +3,685 @@
 // * MAIN
 int main(int argc, char **argv)
 {
+    // * Command line options
+    enum StrangeAttractorType startAttractor = LORENZ;
+    char *posterPath = NULL;
+    int posterWidth = 0, posterHeight = 0;
+    char *videoPath = NULL;
+    int videoFrames = 0;
+    char *benchPath = NULL;
+    char *baselinePath = NULL;
+    char *cpuCap = NULL;
+    char *spectrumSets = NULL, *spectrumPath = NULL;
+    int spectrumSteps = 0, qrInterval = LYAPUNOV_RENORMALIZE;
+    char *mapPath = NULL;
+    char *sectionPath = NULL;
+    int sectionSteps = 0;
+    double sectionPlaneValues[4], *sectionPlaneOption = NULL;
+    char *sweepSpec = NULL, *sweepJournal = NULL;
+    char *cachePath = CACHE_FILE;
+    int sweepSteps = 0;
+    int mapWidth = 0, mapHeight = 0, mapAxes = 0;
+    struct VideoKeyframes keyframes = {0};
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--model") && i + 1 < argc) {
+            int n = atoi(argv[++i]);
+            if (n >= 1 && n <= MODEL_COUNT) startAttractor = n - 1;
+        }
+        else if (!strcmp(argv[i], "--poster") && i + 3 < argc) {
+            posterWidth = atoi(argv[++i]);
+            posterHeight = atoi(argv[++i]);
+            posterPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--video") && i + 2 < argc) {
+            videoFrames = atoi(argv[++i]);
+            videoPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--to") && i + 3 < argc) {
+            keyframes.parameters = 1;
+            keyframes.a = atof(argv[++i]);
+            keyframes.b = atof(argv[++i]);
+            keyframes.c = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--turns") && i + 1 < argc) {
+            keyframes.turns = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            initializeTrace(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--bench") && i + 1 < argc) {
+            benchPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--perfcheck") && i + 1 < argc) {
+            baselinePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--cpu") && i + 1 < argc) {
+            cpuCap = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--spectrum") && i + 3 < argc) {
+            spectrumSteps = atoi(argv[++i]);
+            spectrumSets = argv[++i];
+            spectrumPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--qr") && i + 1 < argc) {
+            qrInterval = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--lyapunov-map") && i + 3 < argc) {
+            mapWidth = atoi(argv[++i]);
+            mapHeight = atoi(argv[++i]);
+            mapPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--axes") && i + 1 < argc) {
+            mapAxes = !strcmp(argv[++i], "bc");
+        }
+        else if (!strcmp(argv[i], "--section") && i + 2 < argc) {
+            sectionSteps = atoi(argv[++i]);
+            sectionPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--sweep") && i + 3 < argc) {
+            sweepSteps = atoi(argv[++i]);
+            sweepSpec = argv[++i];
+            sweepJournal = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--cache") && i + 1 < argc) {
+            cachePath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--plane") && i + 4 < argc) {
+            for (int k = 0; k < 4; k++) sectionPlaneValues[k] = atof(argv[++i]);
+            sectionPlaneOption = sectionPlaneValues;
+        }
+        else {
+            fprintf(stderr, "Usage: %s [--model 1-%d] [--poster WIDTH HEIGHT out.ppm|out.png]\n", argv[0], MODEL_COUNT);
+            fprintf(stderr, "       %*s [--video FRAMES out.y4m|out.rgb|-] [--to A B C] [--turns T]\n", (int)strlen(argv[0]), "");
+            fprintf(stderr, "       %*s [--trace out.json] [--bench out.json|-] [--perfcheck baseline.json]\n", (int)strlen(argv[0]), "");
+            fprintf(stderr, "       %*s [--cpu generic|sse2|avx|avx2|avx512]\n", (int)strlen(argv[0]), "");
+            fprintf(stderr, "       %*s [--spectrum STEPS sets.txt out.csv|-] [--qr INTERVAL]\n", (int)strlen(argv[0]), "");
+            fprintf(stderr, "       %*s [--lyapunov-map WIDTH HEIGHT out.pfm|out.png] [--axes ab|bc]\n", (int)strlen(argv[0]), "");
+            fprintf(stderr, "       %*s [--section STEPS out.csv|-] [--plane NX NY NZ OFFSET]\n", (int)strlen(argv[0]), "");
+            fprintf(stderr, "       %*s [--sweep STEPS spec.txt journal.csv] [--cache FILE|off]\n", (int)strlen(argv[0]), "");
+            return 1;
+        }
+    }
+
+    // * The performance check reads the results back from the file the benchmarks wrote
+    if (baselinePath && benchPath && !strcmp(benchPath, "-")) {
+        fprintf(stderr, "--perfcheck needs --bench to write a file, not stdout\n");
+        return 1;
+    }
+
+    // * Kernel variants for this CPU and the thread pool
+    selectCpuLevel(cpuCap);
+    initializeJobs(0);
+
+    // * Benchmarks use their own copies of the models
+    if (benchPath || baselinePath) {
+        int status = runBenchmarks(benchPath ? benchPath : PERF_RESULTS);
+        if (!status && baselinePath) status = comparePerformance(baselinePath, benchPath ? benchPath : PERF_RESULTS);
+        freeJobs();
+        printMemorySummary();
+        writeTrace();
+        return status;
+    }
+
+    // * Headless Lyapunov spectra of many parameter sets
+    if (spectrumPath) {
+        int status = runSpectrum(startAttractor, spectrumSteps, qrInterval, spectrumSets, spectrumPath);
+        freeJobs();
+        printMemorySummary();
+        writeTrace();
+        return status;
+    }
+
+    // * Headless parameter sweep, the cache and the journal both skip entries computed before
+    if (sweepJournal) {
+        openResultCache(cachePath);
+        int status = runSweep(sweepSteps, qrInterval, sweepSpec, sweepJournal);
+        closeResultCache();
+        freeJobs();
+        printMemorySummary();
+        writeTrace();
+        return status;
+    }
+
+    // Set initial attractor
+    useAttractor(attractorCreate(startAttractor));
+
+    // * Offline render, no window needed
+    if (posterPath) {
+        int status = renderPoster(posterWidth, posterHeight, posterPath);
+        attractorDestroy(attractor);
+        freeJobs();
+        printMemorySummary();
+        writeTrace();
+        return status;
+    }
+    if (sectionPath) {
+        int status = exportSection(sectionSteps, sectionPlaneOption, sectionPath);
+        attractorDestroy(attractor);
+        freeJobs();
+        printMemorySummary();
+        writeTrace();
+        return status;
+    }
+    if (mapPath) {
+        openResultCache(cachePath);
+        int status = renderLyapunovMapFile(mapWidth, mapHeight, mapAxes, qrInterval, mapPath);
+        closeResultCache();
+        attractorDestroy(attractor);
+        freeJobs();
+        printMemorySummary();
+        writeTrace();
+        return status;
+    }
+    if (videoPath) {
+        int status = renderVideo(videoFrames, videoPath, &keyframes);
+        attractorDestroy(attractor);
+        freeJobs();
+        printMemorySummary();
+        writeTrace();
+        return status;
+    }
+
     // * Initialize SDL
     SDL_Window *window = SDL_CreateWindow("Strange Attractors", 10, 10, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_BORDERLESS | SDL_WINDOW_RESIZABLE);
     SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
     SDL_RenderSetLogicalSize(renderer, 1280, 720);
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
-
-    // Set initial attractor
-    currentAttractorType = LORENZ;
-    currentAttractor = &(AttractorModels[currentAttractorType]);
-
-    // Save default model
-    defaultModel = *currentAttractor;
-    initializeFrustum();
-    initializeModel();
+    initializeDensity(renderer);
+    openResultCache(cachePath);
+    initializeWarmStart();
+    applyWarmStart(startAttractor);
+    resetResimulation();
+    initializeLyapunovMap(renderer);
+    initializeBifurcation(renderer);
+    initializeSection();
+    initializeFramebuffer(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
 
     // * Main game loop
     int running = 1;
-    double minx = 100, maxx = -100, miny = 100, maxy = -100, minz = 100, maxz = -100;
     while (running) {
+        PROFILE_BEGIN(STAGE_FRAME);
         handleEvents(&running);
 
         SDL_GetMouseState(&mouse.x, &mouse.y);
         clear(renderer);
-        if (!colourControl) calculateAttractor();
-
-        // * Render each line
-        int i = 0;
-        float point_i[3];
-        for (struct Point *current_point = currentAttractor->trail.head; current_point != NULL && !colourControl; current_point = current_point->next, i++) {
-            float point_f[3] = {current_point->x, current_point->y, current_point->z};
-
-            // Calculate midpoints
-            {
-                if (current_point->x > maxx) maxx = current_point->x;
-                if (current_point->x < minx) minx = current_point->x;
-                if (current_point->y > maxy) maxy = current_point->y;
-                if (current_point->y < miny) miny = current_point->y;
-                if (current_point->z > maxz) maxz = current_point->z;
-                if (current_point->z < minz) minz = current_point->z;
-            }
-
-            // * Center the model at (0,0,0) and rotate segments
-            point_f[0] -= currentAttractor->midpoint.x;
-            point_f[1] -= currentAttractor->midpoint.y;
-            point_f[2] -= currentAttractor->midpoint.z;
-            rotateX(&point_f[0], &point_f[1], &point_f[2], currentAttractor->rotation.angle_x);
-            rotateY(&point_f[0], &point_f[1], &point_f[2], currentAttractor->rotation.angle_y);
-            rotateZ(&point_f[0], &point_f[1], &point_f[2], currentAttractor->rotation.angle_z);
-            point_f[2] += 1 / (currentAttractor->zoom*currentAttractor->zoom);
-            
-            // * Increment angle
-            currentAttractor->rotation.angle_x = fmod(currentAttractor->rotation.angle_x + currentAttractor->rotation.dangle_x, 2 * PI);
-            currentAttractor->rotation.angle_y = fmod(currentAttractor->rotation.angle_y + currentAttractor->rotation.dangle_y, 2 * PI);
-            currentAttractor->rotation.angle_z = fmod(currentAttractor->rotation.angle_z + currentAttractor->rotation.dangle_z, 2 * PI);
-
-            // * Apply perspective projection
-            project(point_f[0], point_f[1], point_f[2], &point_f[0], &point_f[1], &point_f[2]);
-
-            // * Draw segments
-            if (current_point != currentAttractor->trail.head) {
-                int r, g, b, a;
-                getTrailRGBA(trail_rgba.ri, trail_rgba.rf, trail_rgba.gi, trail_rgba.gf, trail_rgba.bi, trail_rgba.bf, trail_rgba.ai, trail_rgba.af, i, currentAttractor->trail.length, &r, &g, &b, &a);
-                aalineRGBA(renderer, point_i[0], point_i[1], point_f[0], point_f[1], r, g, b, a);
-            }
+        PROFILE_BEGIN(STAGE_SIMULATE);
+        updateTrail();
+        if (!colourControl && !densityControl && !mapControl && !bifurcationControl) attractorStep(attractor);
+
+        // * Render density image
+        if (densityControl && !colourControl) {
+            accumulateDensity();
+            PROFILE_END(STAGE_SIMULATE);
+            PROFILE_BEGIN(STAGE_RASTERIZE);
+            renderDensity(renderer);
+            PROFILE_END(STAGE_RASTERIZE);
+        }
+        else PROFILE_END(STAGE_SIMULATE);
 
-            // * Record points
-            for (int l = 0; l < 3; l++) point_i[l] = point_f[l];
+        // * Render parameter space
+        if (mapControl && !colourControl) {
+            PROFILE_BEGIN(STAGE_RASTERIZE);
+            renderLyapunovMap(renderer);
+            PROFILE_END(STAGE_RASTERIZE);
+        }
+        if (bifurcationControl && !colourControl) {
+            PROFILE_BEGIN(STAGE_RASTERIZE);
+            renderBifurcation(renderer);
+            PROFILE_END(STAGE_RASTERIZE);
+        }
 
-            #ifdef CIRCLE
-                // * Draw Circle at tail and/or head
-                if (current_point == currentAttractor->trail.tail) {
-                    filledCircleRGBA(renderer, point_f[0], point_f[1], 2, 255, 255, 255, 255);
-                }
-            #endif
+        // * Render each line
+        if (!colourControl && !densityControl && !mapControl && !bifurcationControl) {
+            PROFILE_BEGIN(STAGE_TRANSFORM);
+            PROFILE_COUNT(points, transformTrail());
+            PROFILE_END(STAGE_TRANSFORM);
+            PROFILE_BEGIN(STAGE_RASTERIZE);
+            if (depthControl) drawTrailDepth(renderer);
+            else if (geometryControl) drawTrailGeometry(renderer);
+            else drawTrail(renderer, 1, 1, 0);
+            PROFILE_END(STAGE_RASTERIZE);
         }
 
         // Settings
+        PROFILE_BEGIN(STAGE_CONTROLS);
         controls(renderer);
         trailColourControl(renderer);
+        drawSection(renderer);
+        drawProfiler(renderer);
+        PROFILE_END(STAGE_CONTROLS);
 
         // Present
+        PROFILE_BEGIN(STAGE_PRESENT);
         SDL_RenderPresent(renderer);
+        PROFILE_END(STAGE_PRESENT);
+        PROFILE_END(STAGE_FRAME);
+        profileFrame();
     }    
 
-    freeModel(currentAttractor->trail.head);
-    currentAttractor->trail.head = NULL;
+    const struct Bounds *bounds = attractorBounds(attractor);
+    printf("Estimated midpoint: (%.2lf, %.2lf, %.2lf)\n", (bounds->minx+bounds->maxx)/2, (bounds->miny+bounds->maxy)/2, (bounds->minz+bounds->maxz)/2);
+    attractorDestroy(attractor);
+    freeDensity();
+    freeLyapunovMap();
+    freeResimulation();
+    freeWarmStart();
+    closeResultCache();
+    freeBifurcation();
+    freeSection();
+    freeFramebuffer();
+    freeGeometry();
+    freeJobs();
 
     // Quit SDL
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
-
-    printf("Estimated midpoint: (%.2lf, %.2lf, %.2lf)\n", (minx+maxx)/2, (miny+maxy)/2, (minz+maxz)/2);
+    writeTrace();
     
     return 0;
 }
 
 // * FUNCTION DEFINITIONS
-void project(float x, float y, float z, float *x_proj, float *y_proj, float *z_proj)
+void useAttractor(AttractorContext *context)
 {
-    // Project
-    *x_proj = x * (frustum.n / frustum.r);
-    *y_proj = y * (frustum.n / frustum.t);
-    *z_proj = -z * (frustum.f + z + (2 * frustum.f * frustum.n)) / (frustum.f - frustum.n);
+    attractor = context;
+    currentAttractor = attractorModel(context);
+    trailVertices = attractorVertices(context);
+    frustum = attractorFrustum(context);
+    return;
+}
 
-    // Homogenize
-    *x_proj /= -z;
-    *y_proj /= -z;
-    *z_proj /= -z;
+void freeGeometry()
+{
+    memoryFree(geometry.vertices);
+    memoryFree(geometry.indices);
+    geometry.vertices = NULL;
+    geometry.indices = NULL;
+    geometry.capacity = 0;
+    return;
+}
 
-    // Translate to screen
-    *x_proj += frustum.r;
-    *y_proj += frustum.t;
+void drawTrail(SDL_Renderer *renderer, float scale_x, float scale_y, float offset_y)
+{
+    // Vertices are in screen coordinates, `scale` and `offset` map them onto larger or tiled targets
+    struct Vertex *vertices = trailVertices->data;
+    struct Vertex *view = trailVertices->view;
+
+    // * Clip rectangle in target coordinates, one pixel wider for the anti-aliased edge. The far edges stop at
+    // INT16_MAX so the widest posters still fit the Sint16 coordinates of SDL2_gfx
+    SDL_Rect viewport;
+    SDL_RenderGetViewport(renderer, &viewport);
+    struct ClipRect clip = {
+        .x = -1 / scale_x,
+        .y = (-1 - offset_y) / scale_y,
+        .w = (SDL_min(viewport.w + 1, INT16_MAX) + 1) / scale_x,
+        .h = (SDL_min(viewport.h + 1, INT16_MAX) + 1) / scale_y
+    };
+
+    // * Only draw what survives decimation, so cost follows on-screen length
+    attractorDecimate(attractor, scale_x > scale_y ? scale_x : scale_y);
+    for (int k = 1; k < trailVertices->lodCount; k++) {
+        int h = trailVertices->lod[k - 1], i = trailVertices->lod[k];
+        struct Vertex p0 = vertices[h], p1 = vertices[i];
+        if (!clipSegment(frustum, &view[h], &view[i], &p0, &p1, &clip)) continue;
+        PROFILE_COUNT(segments, 1);
+        PROFILE_COUNT(pixels, 1 + SDL_max(fabsf(p1.x - p0.x) * scale_x, fabsf(p1.y - p0.y) * scale_y));
 
-    // Fit screen
-    *x_proj *= SCREEN_WIDTH / (2 * frustum.r);
-    *y_proj *= SCREEN_HEIGHT / (2 * frustum.t);
+        int r, g, b, a;
+        getTrailRGBA(trail_rgba.ri, trail_rgba.rf, trail_rgba.gi, trail_rgba.gf, trail_rgba.bi, trail_rgba.bf, trail_rgba.ai, trail_rgba.af, i, trailVertices->count, &r, &g, &b, &a);
+        aalineRGBA(renderer, p0.x * scale_x, p0.y * scale_y + offset_y, p1.x * scale_x, p1.y * scale_y + offset_y, r, g, b, a);
+    }
 
+    #ifdef CIRCLE
+        // * Draw Circle at tail and/or head
+        int last = trailVertices->count - 1;
+        if (last >= 0 && view[last].z >= frustum->n && view[last].z <= frustum->f) {
+            struct Vertex *tail = &vertices[last];
+            if (tail->x >= clip.x && tail->x <= clip.x + clip.w && tail->y >= clip.y && tail->y <= clip.y + clip.h)
+                filledCircleRGBA(renderer, tail->x * scale_x, tail->y * scale_y + offset_y, 2 * scale_x, 255, 255, 255, 255);
+        }
+    #endif
     return;
 }
 
-void clear(SDL_Renderer *renderer)
-{      
-    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-    SDL_SetRenderDrawColor(renderer, BLACK);
-    SDL_RenderClear(renderer);
+void profileFrame()
+{
+    // Allocations made since the last frame boundary
+    static Uint64 allocations = 0;
+    Uint64 total = memory.allocations;
+    PROFILE_COUNT(allocations, total - allocations);
+    allocations = total;
+
+    profiler.frame = (profiler.frame + 1) % PROFILE_FRAMES;
+    if (profiler.frames < PROFILE_FRAMES) profiler.frames++;
+    memset(profiler.ticks[profiler.frame], 0, sizeof(profiler.ticks[0]));
+    profiler.points[profiler.frame] = 0;
+    profiler.segments[profiler.frame] = 0;
+    profiler.pixels[profiler.frame] = 0;
+    profiler.allocations[profiler.frame] = 0;
+    return;
+}
+
+int compareTicks(const void *a, const void *b)
+{
+    Uint64 x = *(const Uint64 *)a, y = *(const Uint64 *)b;
+    return (x > y) - (x < y);
+}
+
+void drawProfiler(SDL_Renderer *renderer)
+{
+    if (!profilerControl || !profiler.frames) return;
+
+    // * Statistics over the completed frames in the ring, the current frame is still being timed
+    static Uint64 sorted[PROFILE_FRAMES];
+    double ms = 1000.0 / SDL_GetPerformanceFrequency();
+    int n = profiler.frames - (profiler.frames == PROFILE_FRAMES);
+    if (n < 1) return;
+    Uint64 points = 0, segments = 0, allocations = 0;
+    for (int f = 0; f < n; f++) {
+        int frame = (profiler.frame + PROFILE_FRAMES - 1 - f) % PROFILE_FRAMES;
+        points += profiler.points[frame];
+        segments += profiler.segments[frame];
+        allocations += profiler.allocations[frame];
+    }
+
+    int x = 10, y = 10;
+    char s[80];
+    boxRGBA(renderer, x - 5, y - 5, x + 360, y + 15 * (STAGE_COUNT + MEMORY_SUBSYSTEMS + 6), 0, 0, 0, 160);
+    stringRGBA(renderer, x, y, "stage        mean ms   p95 ms   p99 ms", WHITE);
+    double frame_seconds = 0;
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        Uint64 total = 0;
+        for (int f = 0; f < n; f++) {
+            sorted[f] = profiler.ticks[(profiler.frame + PROFILE_FRAMES - 1 - f) % PROFILE_FRAMES][stage];
+            total += sorted[f];
+        }
+        qsort(sorted, n, sizeof(Uint64), compareTicks);
+        if (stage == STAGE_FRAME) frame_seconds = total * ms / 1000;
+        sprintf(s, "%-10s %9.3f %8.3f %8.3f", stageNames[stage], total * ms / n, sorted[(n * 95) / 100] * ms, sorted[(n * 99) / 100] * ms);
+        stringRGBA(renderer, x, y += 15, s, WHITE);
+    }
+    if (frame_seconds > 0) {
+        sprintf(s, "points/s   %.3e", points / frame_seconds);
+        stringRGBA(renderer, x, y += 15, s, WHITE);
+        sprintf(s, "segments/s %.3e", segments / frame_seconds);
+        stringRGBA(renderer, x, y += 15, s, WHITE);
+    }
+
+    // * Memory
+    sprintf(s, "allocs/frame %.1f", allocations / (double)n);
+    stringRGBA(renderer, x, y += 15, s, WHITE);
+    for (int subsystem = 0; subsystem < MEMORY_SUBSYSTEMS; subsystem++) {
+        sprintf(s, "%-12s %10.2f MiB live", memorySubsystemNames[subsystem], memory.live[subsystem] / 1048576.0);
+        stringRGBA(renderer, x, y += 15, s, WHITE);
+    }
+    sprintf(s, "peak RSS     %10.2f MiB", peakResidentBytes() / 1048576.0);
+    stringRGBA(renderer, x, y += 15, s, WHITE);
+    sprintf(s, "kernels      %s", cpuLevelNames[cpuLevel]);
+    stringRGBA(renderer, x, y += 15, s, WHITE);
+    return;
+}
+
+void initializeTrace(const char *path)
+{
+    trace.path = path;
+    trace.start = SDL_GetPerformanceCounter();
+    trace.frequency = SDL_GetPerformanceFrequency();
+    jobs.trace = traceJob;
+    return;
+}
+
+void traceEvent(int lane, const char *name, char phase)
+{
+    // Lanes have a single writer each, so recording needs no locks or atomics.
+    // Events past `TRACE_EVENTS` are dropped
+    if (!trace.path || lane >= TRACE_LANES) return;
+    struct TraceLane *buffer = &trace.lanes[lane];
+    if (!buffer->events) buffer->events = memoryAlloc(TRACE_EVENTS * sizeof(struct TraceEvent), MEMORY_TRACE);
+    if (!buffer->events || buffer->count == TRACE_EVENTS) return;
+    struct TraceEvent *event = &buffer->events[buffer->count++];
+    event->name = name;
+    event->phase = phase;
+    event->ticks = SDL_GetPerformanceCounter();
+    return;
+}
+
+void traceJob(int index, const char *name, char phase)
+{
+    // Hook of the job pool, every job is recorded on the lane of the thread that runs it, job workers each have their own
+    traceEvent(index ? TRACE_WORKERS + index - 1 : TRACE_MAIN, name, phase);
+    return;
+}
+
+void writeTrace()
+{
+    if (!trace.path) return;
+    FILE *file = fopen(trace.path, "w");
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", trace.path);
+        return;
+    }
+
+    // * Chrome trace-event format, one thread per lane
+    fprintf(file, "{\"traceEvents\":[\n");
+    int first = 1;
+    for (int lane = 0; lane < TRACE_LANES; lane++) {
+        struct TraceLane *buffer = &trace.lanes[lane];
+        if (!buffer->count) continue;
+        char name[32];
+        if (lane == TRACE_MAIN) sprintf(name, "main");
+        else if (lane == TRACE_WRITER) sprintf(name, "writer");
+        else sprintf(name, "worker %d", lane - TRACE_WORKERS);
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", lane, name);
+        first = 0;
+
+        for (int e = 0; e < buffer->count; e++) {
+            struct TraceEvent *event = &buffer->events[e];
+            double us = (event->ticks - trace.start) * 1e6 / trace.frequency;
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", event->name, event->phase, us, lane);
+        }
+        if (buffer->count == TRACE_EVENTS) fprintf(stderr, "Trace lane %s filled up, later events were dropped\n", name);
+        memoryFree(buffer->events);
+        buffer->events = NULL;
+        buffer->count = 0;
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return;
+}
+
+void initializeFramebuffer(SDL_Renderer *renderer, int width, int height)
+{
+    framebuffer.width = width;
+    framebuffer.height = height;
+    framebuffer.pixels = memoryCalloc(width * height, sizeof(Uint32), MEMORY_FRAMEBUFFERS);
+    framebuffer.depth = memoryCalloc(width * height, sizeof(float), MEMORY_FRAMEBUFFERS);
+    framebuffer.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+    return;
+}
+
+void freeFramebuffer()
+{
+    SDL_DestroyTexture(framebuffer.texture);
+    memoryFree(framebuffer.pixels);
+    memoryFree(framebuffer.depth);
+    framebuffer.pixels = NULL;
+    framebuffer.depth = NULL;
+    return;
+}
+
+int transformTrail()
+{
+    // Returns the number of points transformed.
+    // Gathering walks the trail in order, the projection is then split across the job system
+    int count = attractorGather(attractor);
+    struct JobGroup group = {0};
+    jobParallelFor(&group, transformJob, "transform trail", attractor, 0, count, TRANSFORM_GRAIN);
+    jobWait(&group);
+    return count;
+}
+
+void transformJob(void *data, int begin, int end)
+{
+    attractorProject(data, begin, end);
+    return;
+}
+
+void clearFramebuffer(void *data, int begin, int end)
+{
+    // Clears colour and depth of rows [begin, end)
+    struct Framebuffer *target = data;
+    for (int p = begin * target->width; p < end * target->width; p++) {
+        target->pixels[p] = 0xFF000000;
+        target->depth[p] = FLT_MAX;
+    }
+    return;
+}
+
+void drawTrailDepth(SDL_Renderer *renderer)
+{
+    struct Vertex *vertices = trailVertices->data;
+    struct Vertex *view = trailVertices->view;
+    struct ClipRect clip = {0, 0, framebuffer.width - 1, framebuffer.height - 1};
+
+    // * Clear colour and depth while the trail is decimated
+    struct JobGroup cleared = {0};
+    jobParallelFor(&cleared, clearFramebuffer, "clear framebuffer", &framebuffer, 0, framebuffer.height, FRAMEBUFFER_ROWS);
+    attractorDecimate(attractor, 1);
+    jobWait(&cleared);
+
+    // * Depth range of the visible trail, for the fog
+    framebuffer.near = FLT_MAX;
+    framebuffer.far = -FLT_MAX;
+    for (int k = 0; k < trailVertices->lodCount; k++) {
+        int i = trailVertices->lod[k];
+        if (view[i].z < frustum->n || view[i].z > frustum->f) continue;
+        if (vertices[i].z < framebuffer.near) framebuffer.near = vertices[i].z;
+        if (vertices[i].z > framebuffer.far) framebuffer.far = vertices[i].z;
+    }
+
+    // * Depth tested segments
+    for (int k = 1; k < trailVertices->lodCount; k++) {
+        int h = trailVertices->lod[k - 1], i = trailVertices->lod[k];
+        struct Vertex p0 = vertices[h], p1 = vertices[i];
+        if (!clipSegment(frustum, &view[h], &view[i], &p0, &p1, &clip)) continue;
+        PROFILE_COUNT(segments, 1);
+        PROFILE_COUNT(pixels, 1 + SDL_max(fabsf(p1.x - p0.x), fabsf(p1.y - p0.y)));
+
+        int r, g, b, a;
+        getTrailRGBA(trail_rgba.ri, trail_rgba.rf, trail_rgba.gi, trail_rgba.gf, trail_rgba.bi, trail_rgba.bf, trail_rgba.ai, trail_rgba.af, i, trailVertices->count, &r, &g, &b, &a);
+        rasterizeSegment(&framebuffer, &p0, &p1, r, g, b, a);
+    }
+
+    SDL_UpdateTexture(framebuffer.texture, NULL, framebuffer.pixels, framebuffer.width * sizeof(Uint32));
+    SDL_RenderCopy(renderer, framebuffer.texture, NULL, NULL);
     return;
 }
 
-void rotateX(float *x, float *y, float *z, float angle)
+CPU_INLINE void rasterizeBody(struct Framebuffer *target, const struct Vertex *p0, const struct Vertex *p1, int r, int g, int b, int a)
 {
-    if (angle == 0) return;
-    float s = sin(angle);
-    float c = cos(angle);
-    float yr = (*y * c) - (*z * s);
-    float zr = (*y * s) + (*z * c);
-    *y = yr;
-    *z = zr;
+    // DDA line with a depth test per pixel, hidden pixels are rejected before any blending happens.
+    // Positions, depths and alphas are computed a span at a time, they don't depend on each other so that part vectorizes.
+    // End points must already be clipped to the framebuffer
+    float dx = p1->x - p0->x, dy = p1->y - p0->y, dz = p1->z - p0->z;
+    int steps = fabsf(dx) > fabsf(dy) ? fabsf(dx) : fabsf(dy);
+    if (steps < 1) steps = 1;
+    float range = target->far - target->near;
+    float fog = fogControl && range > 0 ? DEPTH_FOG / range : 0;
+    int index[RASTER_SPAN], alpha[RASTER_SPAN];
+    float depth[RASTER_SPAN];
+
+    for (int start = 0; start <= steps; start += RASTER_SPAN) {
+        int n = SDL_min(RASTER_SPAN, steps + 1 - start);
+
+        // * Span set up, depth cue fades far pixels towards the background. End points clipped to the near or far plane
+        // can lie outside the depth range of the trail, their fog is clamped so the alpha stays within [0, a]
+        for (int k = 0; k < n; k++) {
+            float t = (start + k) / (float)steps;
+            int x = p0->x + t * dx + 0.5f;
+            int y = p0->y + t * dy + 0.5f;
+            depth[k] = p0->z + t * dz;
+            index[k] = y * target->width + x;
+            alpha[k] = a * (1 - fog * SDL_clamp(depth[k] - target->near, 0, range));
+        }
+
+        // * Early depth test and blend, in order since a span can hit the same pixel twice
+        for (int k = 0; k < n; k++) {
+            int p = index[k];
+            if (depth[k] >= target->depth[p]) continue;
+            target->depth[p] = depth[k];
+
+            Uint32 dst = target->pixels[p];
+            int dr = (dst >> 16) & 0xFF, dg = (dst >> 8) & 0xFF, db = dst & 0xFF;
+            dr += (r - dr) * alpha[k] / RGB_MAX;
+            dg += (g - dg) * alpha[k] / RGB_MAX;
+            db += (b - db) * alpha[k] / RGB_MAX;
+            target->pixels[p] = 0xFF000000 | (dr << 16) | (dg << 8) | db;
+        }
+    }
     return;
 }
+CPU_VARIANTS(rasterize, (struct Framebuffer *target, const struct Vertex *p0, const struct Vertex *p1, int r, int g, int b, int a), (target, p0, p1, r, g, b, a));
 
-void rotateY(float *x, float *y, float *z, float angle)
+void rasterizeSegment(struct Framebuffer *target, const struct Vertex *p0, const struct Vertex *p1, int r, int g, int b, int a)
 {
-    if (angle == 0) return;
-    float s = sin(angle);
-    float c = cos(angle);
-    float xr = (*z * s) + (*x * c);
-    float zr = (*z * c) - (*x * s);
-    *x = xr;
-    *z = zr;
+    rasterizeVariants[cpuLevel](target, p0, p1, r, g, b, a);
     return;
 }
 
-void rotateZ(float *x, float *y, float *z, float angle)
+void drawTrailGeometry(SDL_Renderer *renderer)
 {
-    if (angle == 0) return;
-    float c = cos(angle);
-    float s = sin(angle);
-    float xr = (*x * c) - (*y * s);
-    float yr = (*x * s) + (*y * c);
-    *x = xr;
-    *y = yr;
+    // Every segment becomes a one pixel wide quad and the whole trail is submitted in one SDL_RenderGeometry() call
+    struct Vertex *vertices = trailVertices->data;
+    struct Vertex *view = trailVertices->view;
+    SDL_Rect viewport;
+    SDL_RenderGetViewport(renderer, &viewport);
+    struct ClipRect clip = {-1, -1, viewport.w + 2, viewport.h + 2};
+
+    attractorDecimate(attractor, 1);
+    if (geometry.capacity < trailVertices->lodCount) {
+        geometry.capacity = trailVertices->lodCount;
+        geometry.vertices = memoryRealloc(geometry.vertices, 4 * geometry.capacity * sizeof(SDL_Vertex), MEMORY_VERTICES);
+        geometry.indices = memoryRealloc(geometry.indices, 6 * geometry.capacity * sizeof(int), MEMORY_VERTICES);
+    }
+
+    int quads = 0;
+    for (int k = 1; k < trailVertices->lodCount; k++) {
+        int h = trailVertices->lod[k - 1], i = trailVertices->lod[k];
+        struct Vertex p0 = vertices[h], p1 = vertices[i];
+        if (!clipSegment(frustum, &view[h], &view[i], &p0, &p1, &clip)) continue;
+        PROFILE_COUNT(segments, 1);
+        PROFILE_COUNT(pixels, 1 + SDL_max(fabsf(p1.x - p0.x), fabsf(p1.y - p0.y)));
+
+        int r, g, b, a;
+        getTrailRGBA(trail_rgba.ri, trail_rgba.rf, trail_rgba.gi, trail_rgba.gf, trail_rgba.bi, trail_rgba.bf, trail_rgba.ai, trail_rgba.af, i, trailVertices->count, &r, &g, &b, &a);
+        SDL_Color colour = {r, g, b, a};
+
+        // * Half pixel offsets along the segment's normal
+        float dx = p1.x - p0.x, dy = p1.y - p0.y;
+        float length = sqrtf(dx * dx + dy * dy);
+        float nx = length > 0 ? -0.5f * dy / length : 0.5f, ny = length > 0 ? 0.5f * dx / length : 0;
+        SDL_Vertex *quad = &geometry.vertices[4 * quads];
+        quad[0] = (SDL_Vertex){{p0.x + nx, p0.y + ny}, colour, {0, 0}};
+        quad[1] = (SDL_Vertex){{p0.x - nx, p0.y - ny}, colour, {0, 0}};
+        quad[2] = (SDL_Vertex){{p1.x + nx, p1.y + ny}, colour, {0, 0}};
+        quad[3] = (SDL_Vertex){{p1.x - nx, p1.y - ny}, colour, {0, 0}};
+        int *index = &geometry.indices[6 * quads];
+        int base = 4 * quads;
+        index[0] = base; index[1] = base + 1; index[2] = base + 2;
+        index[3] = base + 1; index[4] = base + 3; index[5] = base + 2;
+        quads++;
+    }
+    if (quads) SDL_RenderGeometry(renderer, NULL, geometry.vertices, 4 * quads, geometry.indices, 6 * quads);
+    return;
+}
+
+void clear(SDL_Renderer *renderer)
+{      
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, BLACK);
+    SDL_RenderClear(renderer);
     return;
 }
 
@@ -198,7 +715,56 @@ void handleEvents(int *running)
                 colourControl = !colourControl;
                 break;
             case SDLK_r: // `R` Restart model
-                setCurrentAttractor(currentAttractorType);
+                setCurrentAttractor(attractorType(attractor));
+                break;
+            case SDLK_z: // `Z` Depth buffer toggle
+                depthControl = !depthControl;
+                break;
+            case SDLK_g: // `G` Batched geometry trail toggle
+                geometryControl = !geometryControl;
+                break;
+            case SDLK_f: // `F` Depth fog toggle
+                fogControl = !fogControl;
+                break;
+            case SDLK_p: // `P` Profiler overlay toggle
+                profilerControl = !profilerControl;
+                break;
+            case SDLK_d: // `D` Density render toggle
+                densityControl = !densityControl;
+                mapControl = bifurcationControl = 0;
+                resetDensity();
+                resetLyapunovMap();
+                resetBifurcation();
+                break;
+            case SDLK_l: // `L` Lyapunov map toggle
+                mapControl = !mapControl;
+                densityControl = bifurcationControl = 0;
+                resetLyapunovMap();
+                resetBifurcation();
+                break;
+            case SDLK_b: // `B` Bifurcation diagram toggle
+                bifurcationControl = !bifurcationControl;
+                densityControl = mapControl = 0;
+                resetLyapunovMap();
+                resetBifurcation();
+                break;
+            case SDLK_x: // `X` Lyapunov map axes, (a, b) or (b, c), or the bifurcation parameter
+                if (bifurcationControl) bifurcation.parameter = (bifurcation.parameter + 1) % 3;
+                else lyapunovMap.axes = !lyapunovMap.axes;
+                resetLyapunovMap();
+                resetBifurcation();
+                break;
+            case SDLK_y: // `Y` Bifurcation coordinate
+                bifurcation.coordinate = (bifurcation.coordinate + 1) % 3;
+                resetBifurcation();
+                break;
+            case SDLK_o: // `O` Poincare section overlay toggle
+                sectionControl = !sectionControl;
+                resetSection();
+                break;
+            case SDLK_n: // `N` Poincare section normal, x, y or z
+                poincare.axis = (poincare.axis + 1) % 3;
+                resetSection();
                 break;
         }
 
@@ -211,73 +777,6 @@ void handleEvents(int *running)
     return;
 }
 
-void calculateAttractor()
-{
-    // * Calculate new point according to current attractor
-    struct Point *newPoint = malloc(sizeof(struct Point));
-    currentAttractor->attractorFunction(newPoint);
-
-    // * Append new point to the model
-    newPoint->next = NULL;
-    currentAttractor->trail.tail->next = newPoint;
-    currentAttractor->trail.tail = newPoint;
-    currentAttractor->trail.length++;
-    
-    // * Remove head(s)
-    int frees = (currentAttractor->trail.length >= currentAttractor->trail.maxLength) + (currentAttractor->trail.length > currentAttractor->trail.maxLength);
-    for (int i = 0; i < frees; i++) {
-        struct Point *oldHead = currentAttractor->trail.head;
-        currentAttractor->trail.head = currentAttractor->trail.head->next;
-        free(oldHead);
-        currentAttractor->trail.length--;
-    }
-
-    return;
-}
-
-void freeModel(struct Point *head)
-{
-    if (head->next) freeModel(head->next);
-    head->next = NULL;
-    currentAttractor->trail.length--;
-    free(head);
-    return;
-}
-
-void initializeModel()
-{
-    // Initial point
-    currentAttractor->trail.head = malloc(sizeof(struct Point));
-    currentAttractor->trail.tail = currentAttractor->trail.head;
-    currentAttractor->trail.tail->x = currentAttractor->initialPosition.x;
-    currentAttractor->trail.tail->y = currentAttractor->initialPosition.y;
-    currentAttractor->trail.tail->z = currentAttractor->initialPosition.z;
-    currentAttractor->trail.length++;
-
-    // Initial trail
-    struct Point *next_point = currentAttractor->trail.tail;
-    while (currentAttractor->trail.length < currentAttractor->trail.maxLength) {
-        struct Point *new_point = malloc(sizeof(struct Point));
-        new_point->next = next_point;
-
-        new_point->x = default_x;
-        new_point->y = default_y;
-        new_point->z = default_z;
-        
-        next_point = new_point;
-        currentAttractor->trail.head = new_point;
-        currentAttractor->trail.length++;
-    }
-    return;
-}
-
-void initializeFrustum()
-{
-    frustum.r = frustum.n * tan(FOV / 2);
-    frustum.t = frustum.r / aspect_ratio;
-    return;
-}
-
 void controls(SDL_Renderer *renderer)
 {
     if (settings) {
@@ -334,6 +833,14 @@ void controls(SDL_Renderer *renderer)
                 sliders[i].selected = 0;
             }
         }
+
+        // * Largest Lyapunov exponent, follows the sliders while they are dragged
+        double exponent = attractorLyapunov(attractor, LYAPUNOV_STEPS);
+        char s[80];
+        if (isinf(exponent)) sprintf(s, "Largest Lyapunov exponent: unbounded, the orbit escapes");
+        else if (isnan(exponent)) sprintf(s, "Largest Lyapunov exponent: ...");
+        else sprintf(s, "Largest Lyapunov exponent: %+.3f (%s)", exponent, exponent > LYAPUNOV_CHAOTIC ? "chaotic" : exponent < -LYAPUNOV_CHAOTIC ? "fixed point" : "periodic");
+        stringRGBA(renderer, spacing - 30, bottom + 30, s, 255, 255, 255, alpha);
     }
     return;
 }
@@ -465,124 +972,1819 @@ void getTrailRGBA(int ri, int rf, int gi, int gf, int bi, int bf, int ai, int af
 
 void setCurrentAttractor(enum StrangeAttractorType newAttractorType)
 {
-    // When `newAttractorType` is set as `currentAttractorType`
+    // When `newAttractorType` is the current type
     // this function will simply restart the current Attractor
+    attractorSetModel(attractor, newAttractorType);
+    applyWarmStart(newAttractorType);
+    resetResimulation();
+    resetDensity();
+
+    return;
+}
+
+int renderPoster(int width, int height, const char *path)
+{
+    if (width <= 0 || height <= 0 || width > INT16_MAX || height > INT16_MAX) {
+        fprintf(stderr, "Poster size must be between 1 and %d pixels\n", INT16_MAX);
+        return 1;
+    }
+    const char *extension = strrchr(path, '.');
+    int png = extension && !strcmp(extension, ".png");
+
+    // * Grow a full trail, then project it once so every tile sees the same view
+    for (int i = 0; i < currentAttractor->trail.maxLength; i++) attractorStep(attractor);
+    transformTrail();
+    float scale_x = width / (float)SCREEN_WIDTH;
+    float scale_y = height / (float)SCREEN_HEIGHT;
+
+    // * Output file
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+    struct PngWriter writer = {.file = file};
+    if (png) pngBegin(&writer, width, height);
+    else fprintf(file, "P6\n%d %d\n%d\n", width, height, RGB_MAX);
+
+    // * Tile buffers, memory use is bounded by the width times `POSTER_TILE_HEIGHT`
+    int tile_height = height < POSTER_TILE_HEIGHT ? height : POSTER_TILE_HEIGHT;
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, width, tile_height, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    Uint8 *rows = memoryAlloc((size_t)tile_height * (3 * width + 1), MEMORY_OUTPUT);
+    if (!renderer || !rows) {
+        fprintf(stderr, "Could not allocate a %dx%d tile: %s\n", width, tile_height, SDL_GetError());
+        fclose(file);
+        memoryFree(rows);
+        if (surface) SDL_FreeSurface(surface);
+        return 1;
+    }
+
+    // * Render and stream one band of scanlines at a time
+    for (int top = 0; top < height; top += tile_height) {
+        int band = height - top < tile_height ? height - top : tile_height;
+        traceEvent(TRACE_MAIN, "rasterize band", 'B');
+        clear(renderer);
+        drawTrail(renderer, scale_x, scale_y, -top);
+        SDL_RenderPresent(renderer);
+        traceEvent(TRACE_MAIN, "rasterize band", 'E');
+        traceEvent(TRACE_MAIN, "write band", 'B');
+
+        Uint8 *out = rows;
+        for (int y = 0; y < band; y++) {
+            Uint32 *pixel = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch);
+            if (png) *out++ = 0; // Filter type: none
+            for (int x = 0; x < width; x++) {
+                *out++ = pixel[x] >> 16;
+                *out++ = pixel[x] >> 8;
+                *out++ = pixel[x];
+            }
+        }
+        if (png) pngWriteRows(&writer, rows, out - rows, top + band == height);
+        else fwrite(rows, 1, out - rows, file);
+        traceEvent(TRACE_MAIN, "write band", 'E');
+    }
+    if (png) pngEnd(&writer);
+
+    int status = ferror(file);
+    fclose(file);
+    memoryFree(rows);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    if (status) fprintf(stderr, "Could not write %s\n", path);
+    return status != 0;
+}
 
-    // Free old model
-    freeModel(currentAttractor->trail.head);
-    currentAttractor->trail.head = NULL;
+int renderVideo(int frames, const char *path, struct VideoKeyframes *keyframes)
+{
+    if (frames <= 0) {
+        fprintf(stderr, "Video needs at least one frame\n");
+        return 1;
+    }
 
-    // Save old default in old attractor model
-    *currentAttractor = defaultModel;
+    // * Output stream, `-` writes to stdout so the video can be piped into an encoder
+    FILE *file = stdout;
+    if (strcmp(path, "-")) file = fopen(path, "wb");
+    #ifdef _WIN32
+        else _setmode(_fileno(stdout), _O_BINARY);
+    #endif
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+    const char *extension = strrchr(path, '.');
+    struct VideoQueue queue = {
+        .file = file,
+        .y4m = !extension || strcmp(extension, ".rgb"),
+        .frameSize = 3 * SCREEN_WIDTH * SCREEN_HEIGHT,
+        .lock = SDL_CreateMutex(),
+        .filled = SDL_CreateCond(),
+        .emptied = SDL_CreateCond()
+    };
+    if (queue.y4m) fprintf(file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", SCREEN_WIDTH, SCREEN_HEIGHT, VIDEO_FPS);
+    for (int i = 0; i < VIDEO_QUEUE_DEPTH; i++) queue.frames[i] = memoryAlloc(queue.frameSize, MEMORY_OUTPUT);
+
+    // * Offscreen software renderer and the writer thread, every failure from here on goes through the shutdown below
+    int failed = 0;
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    SDL_Thread *writer = NULL;
+    if (!renderer || !queue.lock || !queue.filled || !queue.emptied) {
+        fprintf(stderr, "Could not create offscreen renderer: %s\n", SDL_GetError());
+        failed = 1;
+    }
+    else if (!(writer = SDL_CreateThread(videoWriter, "video writer", &queue))) {
+        fprintf(stderr, "Could not start the video writer: %s\n", SDL_GetError());
+        failed = 1;
+    }
 
-    // Change the current attractor type to the new type
-    currentAttractorType = newAttractorType;
+    // * Grow a full trail before the first frame
+    for (int i = 0; !failed && i < currentAttractor->trail.maxLength; i++) attractorStep(attractor);
+    double a = currentAttractor->parameters.a, b = currentAttractor->parameters.b, c = currentAttractor->parameters.c;
+
+    // * Frame N is flushed by the writer while frame N+1 is rendered here
+    for (int f = 0; !failed && f < frames; f++) {
+        double t = frames > 1 ? f / (double)(frames - 1) : 0;
+        if (keyframes->parameters) {
+            currentAttractor->parameters.a = a + (keyframes->a - a) * t;
+            currentAttractor->parameters.b = b + (keyframes->b - b) * t;
+            currentAttractor->parameters.c = c + (keyframes->c - c) * t;
+        }
+        currentAttractor->rotation.angle_y = fmod(currentAttractor->rotation.angle_y + 2 * PI * keyframes->turns / frames, 2 * PI);
 
-    // Set new model as current attractor
-    currentAttractor = &(AttractorModels[currentAttractorType]);
+        traceEvent(TRACE_MAIN, "render frame", 'B');
+        attractorStep(attractor);
+        transformTrail();
+        clear(renderer);
+        drawTrail(renderer, 1, 1, 0);
+        SDL_RenderPresent(renderer);
+        traceEvent(TRACE_MAIN, "render frame", 'E');
+
+        // Wait for a free slot, or stop when the writer failed
+        traceEvent(TRACE_MAIN, "wait for writer", 'B');
+        SDL_LockMutex(queue.lock);
+        while (queue.count == VIDEO_QUEUE_DEPTH && !queue.failed) SDL_CondWait(queue.emptied, queue.lock);
+        failed = queue.failed;
+        Uint8 *frame = queue.frames[(queue.head + queue.count) % VIDEO_QUEUE_DEPTH];
+        SDL_UnlockMutex(queue.lock);
+        traceEvent(TRACE_MAIN, "wait for writer", 'E');
+        if (failed) break;
+
+        traceEvent(TRACE_MAIN, "convert frame", 'B');
+        convertFrame(surface, frame, queue.y4m);
+        traceEvent(TRACE_MAIN, "convert frame", 'E');
+
+        SDL_LockMutex(queue.lock);
+        queue.count++;
+        SDL_CondSignal(queue.filled);
+        SDL_UnlockMutex(queue.lock);
+    }
 
-    // Save new attractor's default
-    defaultModel = *currentAttractor;
+    // * Shutdown, the writer drains the queue or drops it after a failed write
+    if (writer) {
+        SDL_LockMutex(queue.lock);
+        queue.done = 1;
+        SDL_CondSignal(queue.filled);
+        SDL_UnlockMutex(queue.lock);
+        SDL_WaitThread(writer, NULL);
+    }
+    int status = failed || queue.failed || ferror(file);
+    if (file != stdout) {
+        if (fclose(file)) status = 1;
+    }
+    else if (fflush(file)) status = 1;
+    for (int i = 0; i < VIDEO_QUEUE_DEPTH; i++) memoryFree(queue.frames[i]);
+    if (queue.filled) SDL_DestroyCond(queue.filled);
+    if (queue.emptied) SDL_DestroyCond(queue.emptied);
+    if (queue.lock) SDL_DestroyMutex(queue.lock);
+    if (renderer) SDL_DestroyRenderer(renderer);
+    if (surface) SDL_FreeSurface(surface);
+    if (status) fprintf(stderr, "Could not write %s\n", path);
+    return status != 0;
+}
 
-    // Initialize model as the new model
-    initializeModel();
+int videoWriter(void *data)
+{
+    struct VideoQueue *queue = data;
+    while (1) {
+        SDL_LockMutex(queue->lock);
+        while (!queue->count && !queue->done) SDL_CondWait(queue->filled, queue->lock);
+        if (!queue->count) {
+            SDL_UnlockMutex(queue->lock);
+            break;
+        }
+        Uint8 *frame = queue->frames[queue->head];
+        SDL_UnlockMutex(queue->lock);
+
+        // * After a failed write the remaining frames are only dropped, so the renderer never waits for a slot forever
+        traceEvent(TRACE_WRITER, "write frame", 'B');
+        int written = queue->failed || ((!queue->y4m || fputs("FRAME\n", queue->file) >= 0) && fwrite(frame, 1, queue->frameSize, queue->file) == queue->frameSize);
+        traceEvent(TRACE_WRITER, "write frame", 'E');
+
+        SDL_LockMutex(queue->lock);
+        if (!written) queue->failed = 1;
+        queue->head = (queue->head + 1) % VIDEO_QUEUE_DEPTH;
+        queue->count--;
+        SDL_CondSignal(queue->emptied);
+        SDL_UnlockMutex(queue->lock);
+    }
+    return 0;
+}
 
+void convertFrame(SDL_Surface *surface, Uint8 *frame, int y4m)
+{
+    // Packed RGB, or three full resolution Y, Cb, Cr planes (BT.601 studio range) for Y4M
+    int size = surface->w * surface->h;
+    for (int y = 0; y < surface->h; y++) {
+        Uint32 *pixel = (Uint32 *)((Uint8 *)surface->pixels + y * surface->pitch);
+        for (int x = 0; x < surface->w; x++) {
+            int r = (pixel[x] >> 16) & 0xFF, g = (pixel[x] >> 8) & 0xFF, b = pixel[x] & 0xFF;
+            int p = y * surface->w + x;
+            if (!y4m) {
+                frame[3 * p] = r;
+                frame[3 * p + 1] = g;
+                frame[3 * p + 2] = b;
+                continue;
+            }
+            frame[p] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+            frame[size + p] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+            frame[2 * size + p] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+        }
+    }
     return;
 }
 
-// * ATTRACTOR FUNCTIONS
+// * PNG ENCODER
+// Scanlines are written uncompressed as zlib stored blocks so they can be streamed without buffering the image
+
+Uint32 crc32(Uint32 crc, const Uint8 *data, size_t length)
+{
+    static Uint32 table[256];
+    if (!table[1]) for (Uint32 n = 0; n < 256; n++) {
+        Uint32 c = n;
+        for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        table[n] = c;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
 
-void BanlueAttractor(struct Point *newPoint)
+void pngChunk(struct PngWriter *writer, const char *type, const Uint8 *data, Uint32 length)
 {
-    float x = currentAttractor->trail.tail->x;
-    float y = currentAttractor->trail.tail->y;
-    float z = currentAttractor->trail.tail->z;
-    double a = currentAttractor->parameters.a;
-    double dt = currentAttractor->dtime;
+    Uint8 header[8] = {length >> 24, length >> 16, length >> 8, length, type[0], type[1], type[2], type[3]};
+    Uint32 crc = crc32(crc32(0, header + 4, 4), data, length);
+    Uint8 footer[4] = {crc >> 24, crc >> 16, crc >> 8, crc};
+    fwrite(header, 1, 8, writer->file);
+    fwrite(data, 1, length, writer->file);
+    fwrite(footer, 1, 4, writer->file);
+    return;
+}
 
-    newPoint->x = x + (y - x) * dt;
-    newPoint->y = y + (-z * tanh(x)) * dt;
-    newPoint->z = z + (-a + (x * y) + abs(y)) * dt;
+void pngBegin(struct PngWriter *writer, int width, int height)
+{
+    static const Uint8 signature[8] = {137, 'P', 'N', 'G', '\r', '\n', 26, '\n'};
+    Uint8 ihdr[13] = {
+        width >> 24, width >> 16, width >> 8, width,
+        height >> 24, height >> 16, height >> 8, height,
+        8, 2, 0, 0, 0 // 8-bit RGB, deflate, no filter, no interlace
+    };
+    fwrite(signature, 1, 8, writer->file);
+    pngChunk(writer, "IHDR", ihdr, 13);
+    writer->adler_a = 1;
+    writer->adler_b = 0;
+    writer->started = 0;
     return;
 }
 
-void LorenzAttractor(struct Point *newPoint)
+void pngWriteRows(struct PngWriter *writer, const Uint8 *rows, size_t length, int last)
 {
-    float x = currentAttractor->trail.tail->x;
-    float y = currentAttractor->trail.tail->y;
-    float z = currentAttractor->trail.tail->z;
-    double a = currentAttractor->parameters.a;
-    double b = currentAttractor->parameters.b;
-    double c = currentAttractor->parameters.c;
-    double dt = currentAttractor->dtime;
+    // Every 65535 bytes of input need a 5 byte stored block header
+    size_t blocks = length / 65535 + 1;
+    Uint8 *data = memoryAlloc(2 + length + 5 * blocks + 4, MEMORY_OUTPUT);
+    Uint8 *out = data;
+
+    // * zlib header once at the start of the stream
+    if (!writer->started) {
+        *out++ = 0x78;
+        *out++ = 0x01;
+        writer->started = 1;
+    }
+
+    // * Stored deflate blocks
+    size_t offset = 0;
+    do {
+        Uint16 size = length - offset > 65535 ? 65535 : length - offset;
+        *out++ = last && offset + size == length;
+        *out++ = size;
+        *out++ = size >> 8;
+        *out++ = ~size;
+        *out++ = (Uint16)~size >> 8;
+        memcpy(out, rows + offset, size);
+        out += size;
+        offset += size;
+    } while (offset < length);
+
+    // * Running Adler-32 of the uncompressed data
+    for (size_t i = 0; i < length; i++) {
+        writer->adler_a = (writer->adler_a + rows[i]) % 65521;
+        writer->adler_b = (writer->adler_b + writer->adler_a) % 65521;
+    }
+    if (last) {
+        Uint32 adler = (writer->adler_b << 16) | writer->adler_a;
+        *out++ = adler >> 24;
+        *out++ = adler >> 16;
+        *out++ = adler >> 8;
+        *out++ = adler;
+    }
 
-    newPoint->x = x + (a * (y - x)) * dt;
-    newPoint->y = y + (x * (b - z) - y) * dt;
-    newPoint->z = z + (x * y - c * z) * dt;
+    pngChunk(writer, "IDAT", data, out - data);
+    memoryFree(data);
     return;
 }
 
-void HalvorsenAttractor(struct Point *newPoint)
+void pngEnd(struct PngWriter *writer)
 {
-    float x = currentAttractor->trail.tail->x;
-    float y = currentAttractor->trail.tail->y;
-    float z = currentAttractor->trail.tail->z;
-    double a = currentAttractor->parameters.a;
-    double dt = currentAttractor->dtime;
+    pngChunk(writer, "IEND", NULL, 0);
+    return;
+}
+
+void initializeDensity(SDL_Renderer *renderer)
+{
+    density.hits = memoryCalloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(Uint32), MEMORY_FRAMEBUFFERS);
+    density.pixels = memoryCalloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(Uint32), MEMORY_FRAMEBUFFERS);
+    density.workerCount = SDL_max(jobs.count, 1);
+    density.workers = memoryCalloc(density.workerCount, sizeof(struct DensityWorker), MEMORY_ENSEMBLE);
+    for (int t = 0; t < density.workerCount; t++)
+        density.workers[t].hits = memoryCalloc(SCREEN_WIDTH * SCREEN_HEIGHT, sizeof(Uint32), MEMORY_ENSEMBLE);
+    density.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
+    SDL_SetTextureBlendMode(density.texture, SDL_BLENDMODE_BLEND);
+    resetDensity();
+    return;
+}
 
-    newPoint->x = x + (-a*x - 4*y - 4*z - y*y) * dt;
-    newPoint->y = y + (-a*y - 4*z - 4*x - z*z) * dt;
-    newPoint->z = z + (-a*z - 4*x - 4*y - x*x) * dt;
+void freeDensity()
+{
+    SDL_DestroyTexture(density.texture);
+    for (int t = 0; t < density.workerCount; t++) memoryFree(density.workers[t].hits);
+    memoryFree(density.workers);
+    density.workers = NULL;
+    density.workerCount = 0;
+    memoryFree(density.hits);
+    memoryFree(density.pixels);
+    density.hits = NULL;
+    density.pixels = NULL;
     return;
 }
 
-void AizawaAttractor(struct Point *newPoint)
+void resetDensity()
 {
-    float x = currentAttractor->trail.tail->x;
-    float y = currentAttractor->trail.tail->y;
-    float z = currentAttractor->trail.tail->z;
-    double a = currentAttractor->parameters.a;
-    double b = currentAttractor->parameters.b;
-    double c = currentAttractor->parameters.c;
-    double dt = currentAttractor->dtime;
+    if (!density.hits) return;
+    memset(density.hits, 0, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(Uint32));
+    density.max = 0;
+    density.samples = 0;
+
+    // Every worker starts from a slightly different point so the threads don't retrace the same orbit
+    for (int t = 0; t < density.workerCount; t++) {
+        struct DensityWorker *worker = &density.workers[t];
+        worker->seed = 2463534242u + 7919 * t;
+        for (int l = 0; l < DENSITY_LANES; l++) {
+            worker->x[l] = currentAttractor->initialPosition.x + 0.001 * (t + density.workerCount * l);
+            worker->y[l] = currentAttractor->initialPosition.y;
+            worker->z[l] = currentAttractor->initialPosition.z;
+        }
+        worker->warm = 0;
+    }
+    return;
+}
 
-    newPoint->x = x + ((z - 0.7) * x - c*y) * dt;
-    newPoint->y = y + (c * x + (z - 0.7) * y) * dt;
-    newPoint->z = z + (0.6 + b*z - ((z*z*z) / 3) - (x*x + y*y)*(1 + a*z) + 0.1*z*x*x*x) * dt;
+void densityWorker(void *data, int begin, int end)
+{
+    for (int t = begin; t < end; t++) densityBatch(&((struct DensityWorker *)data)[t]);
     return;
 }
 
-void LuChenAttractor(struct Point *newPoint)
+void densityBatch(struct DensityWorker *worker)
 {
-    float x = currentAttractor->trail.tail->x;
-    float y = currentAttractor->trail.tail->y;
-    float z = currentAttractor->trail.tail->z;
-    double a = currentAttractor->parameters.a;
-    double b = currentAttractor->parameters.b;
-    double c = currentAttractor->parameters.c;
-    double dt = currentAttractor->dtime;
+    float (*m)[3] = worker->rotation;
+    float depth = 1 / (worker->model.zoom * worker->model.zoom);
 
-    newPoint->x = x + (-((a*b*x) / (a+b)) - y*z + c) * dt;
-    newPoint->y = y + (a*y + x*z) * dt;
-    newPoint->z = z + (b*z + x*y) * dt;
+    // * Skip the transient so points off the attractor aren't splatted
+    if (worker->warm < DENSITY_TRANSIENT) {
+        attractorIntegrate(&worker->model, worker->x, worker->y, worker->z, DENSITY_LANES, DENSITY_TRANSIENT - worker->warm);
+        worker->warm = DENSITY_TRANSIENT;
+    }
 
-    // printf("(%.2f, %.2f, %.2f)\n", currentAttractor->parameters.angle_x, currentAttractor->parameters.angle_y, currentAttractor->parameters.angle_z);
-    
+    // * Every step advances all lanes at once
+    for (int s = 0; s < DENSITY_STEPS / DENSITY_LANES; s++) {
+        attractorIntegrate(&worker->model, worker->x, worker->y, worker->z, DENSITY_LANES, 1);
+        for (int l = 0; l < DENSITY_LANES; l++) {
+            // * Center, rotate and project, same as the trail renderer
+            float x = worker->x[l] - worker->model.midpoint.x;
+            float y = worker->y[l] - worker->model.midpoint.y;
+            float z = worker->z[l] - worker->model.midpoint.z;
+            float p[3] = {
+                m[0][0] * x + m[0][1] * y + m[0][2] * z,
+                m[1][0] * x + m[1][1] * y + m[1][2] * z,
+                m[2][0] * x + m[2][1] * y + m[2][2] * z + depth
+            };
+            if (p[2] < frustum->n || p[2] > frustum->f) continue;
+            project(frustum, p[0], p[1], p[2], &p[0], &p[1], &p[2]);
+
+            // * Splat with a small jitter so the accumulated image is anti-aliased
+            worker->seed ^= worker->seed << 13;
+            worker->seed ^= worker->seed >> 17;
+            worker->seed ^= worker->seed << 5;
+            int px = p[0] + (worker->seed & 0xFF) / 256.0f;
+            int py = p[1] + (worker->seed >> 24) / 256.0f;
+            if (px >= 0 && px < SCREEN_WIDTH && py >= 0 && py < SCREEN_HEIGHT)
+                worker->hits[py * SCREEN_WIDTH + px]++;
+        }
+    }
     return;
 }
 
-void GenesioAttractor(struct Point *newPoint)
+void mergeDensity(void *data, int begin, int end)
 {
-    float x = currentAttractor->trail.tail->x;
-    float y = currentAttractor->trail.tail->y;
-    float z = currentAttractor->trail.tail->z;
-    double a = currentAttractor->parameters.a;
-    double b = currentAttractor->parameters.b;
-    double c = currentAttractor->parameters.c;
-    double dt = currentAttractor->dtime;
+    // Adds the private buffers of rows [begin, end) into the image and clears them for the next batch
+    Uint32 max = 0;
+    for (int p = begin * SCREEN_WIDTH; p < end * SCREEN_WIDTH; p++) {
+        for (int t = 0; t < density.workerCount; t++) {
+            Uint32 *hits = density.workers[t].hits;
+            if (!hits[p]) continue;
+            density.hits[p] += hits[p];
+            hits[p] = 0;
+        }
+        if (density.hits[p] > max) max = density.hits[p];
+    }
+    static SDL_SpinLock lock;
+    SDL_AtomicLock(&lock);
+    if (max > density.max) density.max = max;
+    SDL_AtomicUnlock(&lock);
+    return;
+}
 
-    newPoint->x = x + (y) * dt;
-    newPoint->y = y + (z) * dt;
-    newPoint->z = z + (-c*x - b*y - a*z + x*x) * dt;
+void accumulateDensity()
+{
+    // * Build rotation matrix from the current angles by rotating the basis vectors
+    float rotation[3][3];
+    for (int j = 0; j < 3; j++) {
+        float v[3] = {j == 0, j == 1, j == 2};
+        rotateX(&v[0], &v[1], &v[2], currentAttractor->rotation.angle_x);
+        rotateY(&v[0], &v[1], &v[2], currentAttractor->rotation.angle_y);
+        rotateZ(&v[0], &v[1], &v[2], currentAttractor->rotation.angle_z);
+        for (int i = 0; i < 3; i++) rotation[i][j] = v[i];
+    }
+
+    // * Restart accumulation when the settings change the image
+    static StrangeAttractor last;
+    if (memcmp(&last.parameters, &currentAttractor->parameters, sizeof(last.parameters)) || last.zoom != currentAttractor->zoom || last.dtime != currentAttractor->dtime)
+        resetDensity();
+    last = *currentAttractor;
+
+    // * Run one batch of steps on every worker, then merge once they are all done
+    struct JobGroup batches = {0}, merge = {0};
+    for (int t = 0; t < density.workerCount; t++) {
+        struct DensityWorker *worker = &density.workers[t];
+        worker->model = *currentAttractor;
+        memcpy(worker->rotation, rotation, sizeof(rotation));
+    }
+    jobParallelFor(&batches, densityWorker, "density batch", density.workers, 0, density.workerCount, 1);
+    jobAfter(&batches, &merge, mergeDensity, "merge density", NULL, 0, SCREEN_HEIGHT, FRAMEBUFFER_ROWS);
+    jobWait(&merge);
+
+    density.samples += (Uint64)density.workerCount * DENSITY_STEPS;
+    PROFILE_COUNT(points, (Uint64)density.workerCount * DENSITY_STEPS);
+    return;
+}
+
+CPU_INLINE void toneMapBody(const Uint32 *restrict hits, Uint32 *restrict pixels, int count, const float *restrict levels, float scale, float exponent, const Uint32 *restrict gradient, const int *restrict alphas)
+{
+    // Common low counts take their level from `levels`, only bright pixels pay for the log and pow
+    for (int p = 0; p < count; p++) {
+        Uint32 h = hits[p];
+        float v = h < TONE_LEVELS ? levels[h] : pow(log(1 + (double)h) * scale, exponent);
+        int i = SDL_min(v * RGB_MAX, RGB_MAX);
+        pixels[p] = h ? ((Uint32)(alphas[i] * v) << 24) | gradient[i] : 0;
+    }
+    return;
+}
+CPU_VARIANTS(toneMap, (const Uint32 *restrict hits, Uint32 *restrict pixels, int count, const float *restrict levels, float scale, float exponent, const Uint32 *restrict gradient, const int *restrict alphas), (hits, pixels, count, levels, scale, exponent, gradient, alphas));
+
+void toneMapRows(void *data, int begin, int end)
+{
+    struct ToneMap *tone = data;
+    int first = begin * SCREEN_WIDTH;
+    toneMapVariants[cpuLevel](density.hits + first, density.pixels + first, (end - begin) * SCREEN_WIDTH, tone->levels, tone->scale, tone->exponent, tone->gradient, tone->alphas);
+    return;
+}
+
+void renderDensity(SDL_Renderer *renderer)
+{
+    if (!density.max) return;
+
+    // * Log density tone mapping through the trail gradient, the gradient and the low levels are tabulated once per frame
+    static struct ToneMap tone;
+    tone.scale = 1 / log(1 + (double)density.max);
+    tone.exponent = 1 / density.gamma;
+    for (int h = 0; h < TONE_LEVELS; h++) tone.levels[h] = pow(log(1 + (double)h) * tone.scale, tone.exponent);
+    for (int i = 0; i <= RGB_MAX; i++) {
+        int r, g, b;
+        getTrailRGBA(trail_rgba.ri, trail_rgba.rf, trail_rgba.gi, trail_rgba.gf, trail_rgba.bi, trail_rgba.bf, trail_rgba.ai, trail_rgba.af, i, RGB_MAX, &r, &g, &b, &tone.alphas[i]);
+        tone.gradient[i] = (r << 16) | (g << 8) | b;
+    }
+    struct JobGroup group = {0};
+    jobParallelFor(&group, toneMapRows, "tone map", &tone, 0, SCREEN_HEIGHT, FRAMEBUFFER_ROWS);
+    jobWait(&group);
+    SDL_UpdateTexture(density.texture, NULL, density.pixels, SCREEN_WIDTH * sizeof(Uint32));
+    SDL_RenderCopy(renderer, density.texture, NULL, NULL);
+
+    // * Sample count
+    char s[40];
+    sprintf(s, "%.0f million points", density.samples / 1e6);
+    stringRGBA(renderer, 10, SCREEN_HEIGHT - 20, s, WHITE);
+    return;
+}
+
+// * LYAPUNOV SPECTRUM
+
+int runSpectrum(enum StrangeAttractorType type, int steps, int interval, const char *setsPath, const char *path)
+{
+    // Full spectrum and Kaplan-Yorke dimension for every "a b c" line of `setsPath`, one CSV row per set
+    FILE *sets = fopen(setsPath, "r");
+    if (!sets) {
+        fprintf(stderr, "Could not open %s\n", setsPath);
+        return 1;
+    }
+    int count = 0, capacity = 64;
+    double (*parameters)[3] = memoryAlloc(capacity * sizeof(*parameters), MEMORY_ENSEMBLE);
+    char line[256];
+    while (fgets(line, sizeof(line), sets)) {
+        double a, b, c;
+        if (sscanf(line, "%lf %lf %lf", &a, &b, &c) != 3) continue;
+        if (count == capacity) {
+            capacity *= 2;
+            parameters = memoryRealloc(parameters, capacity * sizeof(*parameters), MEMORY_ENSEMBLE);
+        }
+        parameters[count][0] = a;
+        parameters[count][1] = b;
+        parameters[count][2] = c;
+        count++;
+    }
+    fclose(sets);
+    if (!count || steps <= LYAPUNOV_TRANSIENT) {
+        fprintf(stderr, "Spectrum needs parameter sets and more than %d steps\n", LYAPUNOV_TRANSIENT);
+        memoryFree(parameters);
+        return 1;
+    }
+    FILE *file = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", path);
+        memoryFree(parameters);
+        return 1;
+    }
+
+    // * Chunks of steps over all sets, jobs take ranges of sets so each one runs the vectorized kernel
+    struct LyapunovBatch *batch = lyapunovBatchCreate(&attractorDefaults[type], (const double (*)[3])parameters, count, interval);
+    fprintf(stderr, "%s: %d parameter sets, %d steps, QR every %d steps, %s kernels\n", attractorNames[type], count, steps, batch->interval, cpuLevelNames[cpuLevel]);
+    for (int done = 0; done < steps; ) {
+        struct SpectrumRun run = {batch, SDL_min(SPECTRUM_CHUNK, steps - done)};
+        struct JobGroup group = {0};
+        jobParallelFor(&group, spectrumJob, "lyapunov spectrum", &run, 0, count, SPECTRUM_GRAIN);
+        jobWait(&group);
+        done += run.steps;
+        fprintf(stderr, "\r%3d%%", (int)(100.0 * done / steps));
+    }
+    fprintf(stderr, "\n");
+
+    // * One row per set, escaped orbits have infinite exponents and no dimension
+    fprintf(file, "a,b,c,l1,l2,l3,dky,class\n");
+    for (int i = 0; i < count; i++) {
+        double spectrum[3];
+        lyapunovBatchSpectrum(batch, i, spectrum);
+        const char *kind = isinf(spectrum[0]) ? "escaped" : spectrum[0] > LYAPUNOV_CHAOTIC ? "chaotic" : spectrum[0] < -LYAPUNOV_CHAOTIC ? "fixed point" : "periodic";
+        fprintf(file, "%.17g,%.17g,%.17g,%.6g,%.6g,%.6g,%.6g,%s\n", parameters[i][0], parameters[i][1], parameters[i][2], spectrum[0], spectrum[1], spectrum[2], kaplanYorke(spectrum), kind);
+    }
+    lyapunovBatchDestroy(batch);
+    memoryFree(parameters);
+
+    int status = ferror(file);
+    if (file != stdout) fclose(file);
+    if (status) fprintf(stderr, "Could not write %s\n", path);
+    return status != 0;
+}
+
+void spectrumJob(void *data, int begin, int end)
+{
+    struct SpectrumRun *run = data;
+    lyapunovBatchRun(run->batch, begin, end, run->steps);
+    return;
+}
+
+// * WARM START
+
+void initializeWarmStart()
+{
+    for (int type = 0; type < MODEL_COUNT; type++)
+        warmStart.trails[type] = memoryAlloc(attractorDefaults[type].trail.maxLength * sizeof(*warmStart.trails[type]), MEMORY_TRAIL);
+    jobParallelFor(&warmStart.group, warmStartJob, "warm start", &warmStart, 0, MODEL_COUNT, 1);
+    return;
+}
+
+void freeWarmStart()
+{
+    jobWait(&warmStart.group);
+    for (int type = 0; type < MODEL_COUNT; type++) {
+        memoryFree(warmStart.trails[type]);
+        warmStart.trails[type] = NULL;
+    }
+    return;
+}
+
+void warmStartJob(void *data, int begin, int end)
+{
+    // The transient runs in double precision like the other analyses, the trail itself in the trail's float steps
+    struct WarmStart *warm = data;
+    for (int type = begin; type < end; type++)
+        warm->finite[type] = settleTrail(&attractorDefaults[type], warm->trails[type], attractorDefaults[type].trail.maxLength, -1);
+    return;
+}
+
+int settleTrail(const StrangeAttractor *model, float (*points)[3], int count, int generation)
+{
+    // `count` trail points of `model` after WARM_TRANSIENT steps from its initial position, 1 when they are finite.
+    // A `generation` of 0 or more gives up with 0 as soon as a newer resimulation was requested. Only the warm start
+    // stores its transient, a resimulation for every slider tick would flood the cache
+    double point[CACHE_VALUES] = {model->initialPosition.x, model->initialPosition.y, model->initialPosition.z};
+    struct CacheKey key;
+    transientKey(model, WARM_TRANSIENT, &key);
+    if (!cacheLookup(resultCache, &key, point)) {
+        for (int done = 0; done < WARM_TRANSIENT; done += WARM_CHUNK) {
+            if (generation >= 0 && SDL_AtomicGet(&resimulation.generation) != generation) return 0;
+            attractorOrbit(model, point, SDL_min(WARM_CHUNK, WARM_TRANSIENT - done), NULL);
+        }
+        if (generation < 0) cacheStore(resultCache, &key, point, 3);
+    }
+    if (generation >= 0 && SDL_AtomicGet(&resimulation.generation) != generation) return 0;
+    attractorTrail(model, point, points, count);
+    return isfinite(points[count - 1][0] + points[count - 1][1] + points[count - 1][2]);
+}
+
+void applyWarmStart(enum StrangeAttractorType type)
+{
+    // Swaps the freshly reset trail of `type` for its precomputed one, the jobs take milliseconds so at worst this
+    // waits for them once right after startup
+    if (!warmStart.trails[type]) return;
+    jobWait(&warmStart.group);
+    if (!warmStart.finite[type]) return;
+    attractorLoadTrail(attractor, (const float (*)[3])warmStart.trails[type], attractorDefaults[type].trail.maxLength);
+    return;
+}
+
+// * TRAIL RESIMULATION
+
+void resetResimulation()
+{
+    // The current model is up to date, requests still running are stale
+    resimulation.model = *currentAttractor;
+    SDL_AtomicIncRef(&resimulation.generation);
+    return;
+}
+
+void freeResimulation()
+{
+    SDL_AtomicIncRef(&resimulation.generation);
+    jobWait(&resimulation.group);
+    freeTrailRequest(SDL_AtomicSetPtr(&resimulation.ready, NULL));
+    return;
+}
+
+void freeTrailRequest(struct TrailRequest *request)
+{
+    if (!request) return;
+    memoryFree(request->points);
+    memoryFree(request);
+    return;
+}
+
+void trailJob(void *data, int begin, int end)
+{
+    // A finished request replaces the one waiting in `ready`, which was older and is dropped
+    struct TrailRequest *request = data;
+    request->finite = settleTrail(&request->model, request->points, request->model.trail.maxLength, request->generation);
+    if (SDL_AtomicGet(&resimulation.generation) == request->generation) request = SDL_AtomicSetPtr(&resimulation.ready, request);
+    freeTrailRequest(request);
+    return;
+}
+
+void updateTrail()
+{
+    // * A new request whenever a, b, c or dt moved since the last one
+    if (modelChanged(&resimulation.model)) {
+        struct TrailRequest *request = memoryAlloc(sizeof(struct TrailRequest), MEMORY_TRAIL);
+        request->model = *currentAttractor;
+        request->model.trail.head = request->model.trail.tail = NULL;
+        request->generation = SDL_AtomicIncRef(&resimulation.generation) + 1;
+        request->points = memoryAlloc(request->model.trail.maxLength * sizeof(*request->points), MEMORY_TRAIL);
+        resimulation.model = request->model;
+        jobRun(&resimulation.group, trailJob, "resimulate trail", request, 0, 1);
+    }
+
+    // * Swap in the newest finished trail unless a newer request is still running
+    struct TrailRequest *done = SDL_AtomicSetPtr(&resimulation.ready, NULL);
+    if (done && done->finite && done->generation == SDL_AtomicGet(&resimulation.generation))
+        attractorLoadTrail(attractor, (const float (*)[3])done->points, done->model.trail.maxLength);
+    freeTrailRequest(done);
+    return;
+}
+
+// * RESULT CACHE
+
+void openResultCache(const char *path)
+{
+    // "off" runs without a cache, a file that can't be mapped only costs a warning
+    if (!strcmp(path, "off")) return;
+    resultCache = cacheOpen(path);
+    if (!resultCache) fprintf(stderr, "Could not open the result cache %s, running without it\n", path);
+    return;
+}
+
+void closeResultCache()
+{
+    if (!resultCache) return;
+    fprintf(stderr, "Cache: %llu hits (%llu in memory), %llu misses, %llu of %d records used\n", (unsigned long long)resultCache->hits,
+        (unsigned long long)resultCache->frontHits, (unsigned long long)resultCache->misses, (unsigned long long)resultCache->header->records, CACHE_CAPACITY);
+    cacheClose(resultCache);
+    resultCache = NULL;
+    return;
+}
+
+// * LYAPUNOV MAP
+
+void mapParameters(const StrangeAttractor *model, int axes, double u, double v, double parameters[3])
+{
+    // (u, v) in [0, 1] across and down the image to (a, b, c), each axis spans MAP_SPAN of its current value either side
+    parameters[0] = model->parameters.a;
+    parameters[1] = model->parameters.b;
+    parameters[2] = model->parameters.c;
+    double across = parameters[axes], up = parameters[axes + 1];
+    parameters[axes] = across + (2 * u - 1) * MAP_SPAN * fmax(fabs(across), 1);
+    parameters[axes + 1] = up + (1 - 2 * v) * MAP_SPAN * fmax(fabs(up), 1);
+    return;
+}
+
+Uint32 lyapunovColour(float exponent, float positive, float negative)
+{
+    // Chaos runs from dark red to yellow and order from dark to light blue, relative to the extremes of the image.
+    // Escaped orbits are grey
+    if (isinf(exponent)) return 0xff404040;
+    if (isnan(exponent)) return 0xff000000;
+    float t = exponent > 0 ? (positive > 0 ? exponent / positive : 0) : (negative < 0 ? exponent / negative : 0);
+    t = sqrtf(SDL_min(t, 1));
+    if (exponent > 0) return 0xff000000 | (Uint32)(64 + 191 * t) << 16 | (Uint32)(255 * t * t) << 8;
+    return 0xff000000 | (Uint32)(48 * t) << 8 | (Uint32)(64 + 191 * t);
+}
+
+void initializeLyapunovMap(SDL_Renderer *renderer)
+{
+    lyapunovMap.exponents = memoryAlloc(MAP_WIDTH * MAP_HEIGHT * sizeof(float), MEMORY_FRAMEBUFFERS);
+    lyapunovMap.pixels = memoryAlloc(MAP_WIDTH * MAP_HEIGHT * sizeof(Uint32), MEMORY_FRAMEBUFFERS);
+    lyapunovMap.indices = memoryAlloc(MAP_WIDTH * MAP_HEIGHT * sizeof(int), MEMORY_ENSEMBLE);
+    lyapunovMap.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, MAP_WIDTH, MAP_HEIGHT);
+    resetLyapunovMap();
+    return;
+}
+
+void freeLyapunovMap()
+{
+    resetLyapunovMap();
+    SDL_DestroyTexture(lyapunovMap.texture);
+    memoryFree(lyapunovMap.exponents);
+    memoryFree(lyapunovMap.pixels);
+    memoryFree(lyapunovMap.indices);
+    lyapunovMap.exponents = NULL;
+    lyapunovMap.pixels = NULL;
+    lyapunovMap.indices = NULL;
+    return;
+}
+
+void resetLyapunovMap()
+{
+    // Jobs still running see `cancel` within MAP_CHUNK steps, the map starts over from the coarsest level
+    if (!lyapunovMap.exponents) return;
+    SDL_AtomicSet(&lyapunovMap.cancel, 1);
+    jobWait(&lyapunovMap.group);
+    SDL_AtomicSet(&lyapunovMap.cancel, 0);
+    lyapunovBatchDestroy(lyapunovMap.batch);
+    lyapunovMap.batch = NULL;
+    for (int i = 0; i < MAP_WIDTH * MAP_HEIGHT; i++) {
+        lyapunovMap.exponents[i] = NAN;
+        lyapunovMap.pixels[i] = 0xff000000;
+    }
+    lyapunovMap.positive = lyapunovMap.negative = 0;
+    lyapunovMap.model = *currentAttractor;
+    lyapunovMap.level = -1;
+    return;
+}
+
+void startMapLevel()
+{
+    // Pixels on this level's grid that no coarser level computed, one parameter set each
+    if (++lyapunovMap.level >= MAP_LEVELS) return;
+    int block = 1 << (MAP_LEVELS - 1 - lyapunovMap.level);
+    lyapunovMap.count = 0;
+    for (int y = 0; y < MAP_HEIGHT; y += block) {
+        for (int x = 0; x < MAP_WIDTH; x += block) {
+            if (lyapunovMap.level && x % (2 * block) == 0 && y % (2 * block) == 0) continue;
+            lyapunovMap.indices[lyapunovMap.count++] = y * MAP_WIDTH + x;
+        }
+    }
+
+    // * Cached pixels are painted right away, only the others go into the batch
+    double (*parameters)[3] = memoryAlloc(lyapunovMap.count * sizeof(*parameters), MEMORY_ENSEMBLE);
+    int count = 0;
+    for (int i = 0; i < lyapunovMap.count; i++) {
+        int x = lyapunovMap.indices[i] % MAP_WIDTH, y = lyapunovMap.indices[i] / MAP_WIDTH;
+        struct CacheKey key;
+        double result[CACHE_VALUES];
+        mapParameters(&lyapunovMap.model, lyapunovMap.axes, (x + 0.5) / MAP_WIDTH, (y + 0.5) / MAP_HEIGHT, parameters[count]);
+        lyapunovKey(&lyapunovMap.model, parameters[count], MAP_STEPS, 0, &key);
+        if (cacheLookup(resultCache, &key, result)) mapFill(&lyapunovMap, lyapunovMap.indices[i], result[0]);
+        else lyapunovMap.indices[count++] = lyapunovMap.indices[i];
+    }
+    lyapunovMap.count = count;
+    lyapunovMap.batch = count ? lyapunovBatchCreate(&lyapunovMap.model, (const double (*)[3])parameters, count, 0) : NULL;
+    memoryFree(parameters);
+    if (count && !lyapunovMap.batch) {
+        lyapunovMap.level = MAP_LEVELS;
+        return;
+    }
+    jobParallelFor(&lyapunovMap.group, mapJob, "lyapunov map", &lyapunovMap, 0, lyapunovMap.count, MAP_GRAIN);
+    return;
+}
+
+void mapJob(void *data, int begin, int end)
+{
+    // Every pixel is an independent integration, the result fills the pixel's block of the level
+    struct LyapunovMap *map = data;
+    for (int done = 0; done < MAP_STEPS; done += MAP_CHUNK) {
+        if (SDL_AtomicGet(&map->cancel)) return;
+        lyapunovBatchRun(map->batch, begin, end, MAP_CHUNK);
+    }
+    for (int i = begin; i < end; i++) {
+        struct CacheKey key;
+        double result[LYAPUNOV_RESULT], parameters[3] = {map->batch->a[i], map->batch->b[i], map->batch->c[i]};
+        lyapunovBatchResult(map->batch, i, result);
+        lyapunovKey(&map->model, parameters, MAP_STEPS, 0, &key);
+        cacheStore(resultCache, &key, result, LYAPUNOV_RESULT);
+        mapFill(map, map->indices[i], result[0]);
+    }
+    return;
+}
+
+void mapFill(struct LyapunovMap *map, int pixel, float exponent)
+{
+    // A pixel of the current level paints its whole block
+    int block = 1 << (MAP_LEVELS - 1 - map->level);
+    int x0 = pixel % MAP_WIDTH, y0 = pixel / MAP_WIDTH;
+    for (int y = y0; y < SDL_min(y0 + block, MAP_HEIGHT); y++)
+        for (int x = x0; x < SDL_min(x0 + block, MAP_WIDTH); x++) map->exponents[y * MAP_WIDTH + x] = exponent;
+    return;
+}
+
+void renderLyapunovMap(SDL_Renderer *renderer)
+{
+    // * Start over when the model, its parameters or dt changed
+    const StrangeAttractor *model = &lyapunovMap.model;
+    if (modelChanged(model)) resetLyapunovMap();
+    if (lyapunovMap.level < 0) startMapLevel();
+
+    // * Colour a level once all of its jobs are done and start the next, the frame loop helps in between
+    if (lyapunovMap.level < MAP_LEVELS) {
+        if (SDL_AtomicGet(&lyapunovMap.group.pending)) jobHelp();
+        else {
+            jobWait(&lyapunovMap.group);
+            lyapunovBatchDestroy(lyapunovMap.batch);
+            lyapunovMap.batch = NULL;
+            for (int i = 0; i < MAP_WIDTH * MAP_HEIGHT; i++) {
+                float exponent = lyapunovMap.exponents[i];
+                if (isfinite(exponent)) {
+                    lyapunovMap.positive = SDL_max(lyapunovMap.positive, exponent);
+                    lyapunovMap.negative = SDL_min(lyapunovMap.negative, exponent);
+                }
+            }
+            for (int i = 0; i < MAP_WIDTH * MAP_HEIGHT; i++)
+                lyapunovMap.pixels[i] = lyapunovColour(lyapunovMap.exponents[i], lyapunovMap.positive, lyapunovMap.negative);
+            SDL_UpdateTexture(lyapunovMap.texture, NULL, lyapunovMap.pixels, MAP_WIDTH * sizeof(Uint32));
+            startMapLevel();
+        }
+    }
+    SDL_RenderCopy(renderer, lyapunovMap.texture, NULL, NULL);
+
+    // * Axes and progress
+    static const char *names = "abc";
+    double low[3], high[3];
+    mapParameters(model, lyapunovMap.axes, 0, 1, low);
+    mapParameters(model, lyapunovMap.axes, 1, 0, high);
+    char s[160];
+    int across = lyapunovMap.axes, up = lyapunovMap.axes + 1;
+    sprintf(s, "%c %.2f to %.2f across, %c %.2f to %.2f up", names[across], low[across], high[across], names[up], low[up], high[up]);
+    stringRGBA(renderer, 10, SCREEN_HEIGHT - 30, s, WHITE);
+    if (lyapunovMap.level < MAP_LEVELS) sprintf(s, "Largest Lyapunov exponent, level %d of %d", lyapunovMap.level + 1, MAP_LEVELS);
+    else sprintf(s, "Largest Lyapunov exponent, %+.3f to %+.3f", lyapunovMap.negative, lyapunovMap.positive);
+    stringRGBA(renderer, 10, SCREEN_HEIGHT - 20, s, WHITE);
+    return;
+}
+
+int renderLyapunovMapFile(int width, int height, int axes, int interval, const char *path)
+{
+    // Raw exponents as PFM, or colour mapped PNG. Rows are computed in bands to bound the batch memory
+    if (width <= 0 || height <= 0 || width > INT16_MAX || height > INT16_MAX) {
+        fprintf(stderr, "Map size must be between 1 and %d pixels\n", INT16_MAX);
+        return 1;
+    }
+    const char *extension = strrchr(path, '.');
+    int png = extension && !strcmp(extension, ".png");
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+    float *exponents = memoryAlloc((size_t)width * height * sizeof(float), MEMORY_OUTPUT);
+    double (*parameters)[3] = memoryAlloc((size_t)width * MAP_BAND * sizeof(*parameters), MEMORY_ENSEMBLE);
+    int *misses = memoryAlloc((size_t)width * MAP_BAND * sizeof(int), MEMORY_ENSEMBLE);
+
+    // * Bands of rows as one batch each of the pixels not in the cache, jobs take ranges of pixels
+    fprintf(stderr, "%s: %dx%d map, %d steps per pixel, %s kernels\n", attractorNames[attractorType(attractor)], width, height, MAP_STEPS, cpuLevelNames[cpuLevel]);
+    float positive = 0, negative = 0;
+    for (int top = 0; top < height; top += MAP_BAND) {
+        int count = width * SDL_min(MAP_BAND, height - top), missed = 0;
+        float *band = exponents + (size_t)top * width;
+        for (int i = 0; i < count; i++) {
+            struct CacheKey key;
+            double result[CACHE_VALUES];
+            mapParameters(currentAttractor, axes, (i % width + 0.5) / width, (top + i / width + 0.5) / height, parameters[missed]);
+            lyapunovKey(currentAttractor, parameters[missed], MAP_STEPS, interval, &key);
+            if (cacheLookup(resultCache, &key, result)) band[i] = result[0];
+            else {
+                band[i] = NAN;
+                misses[missed++] = i;
+            }
+        }
+        struct SpectrumRun run = {missed ? lyapunovBatchCreate(currentAttractor, (const double (*)[3])parameters, missed, interval) : NULL, MAP_STEPS};
+        struct JobGroup group = {0};
+        if (run.batch) jobParallelFor(&group, spectrumJob, "lyapunov spectrum", &run, 0, missed, MAP_GRAIN);
+        jobWait(&group);
+        for (int i = 0; run.batch && i < missed; i++) {
+            struct CacheKey key;
+            double result[LYAPUNOV_RESULT];
+            lyapunovBatchResult(run.batch, i, result);
+            lyapunovKey(currentAttractor, parameters[i], MAP_STEPS, interval, &key);
+            cacheStore(resultCache, &key, result, LYAPUNOV_RESULT);
+            band[misses[i]] = result[0];
+        }
+        for (int i = 0; i < count; i++) {
+            if (isfinite(band[i])) {
+                positive = SDL_max(positive, band[i]);
+                negative = SDL_min(negative, band[i]);
+            }
+        }
+        lyapunovBatchDestroy(run.batch);
+        fprintf(stderr, "\r%3d%%", (int)(100.0 * (top + count / width) / height));
+    }
+    fprintf(stderr, "\n");
+    memoryFree(parameters);
+    memoryFree(misses);
+
+    // * PFM stores rows bottom to top, a negative scale means little endian
+    if (png) {
+        struct PngWriter writer = {.file = file};
+        Uint8 *row = memoryAlloc(3 * width + 1, MEMORY_OUTPUT);
+        pngBegin(&writer, width, height);
+        for (int y = 0; y < height; y++) {
+            Uint8 *out = row;
+            *out++ = 0; // Filter type: none
+            for (int x = 0; x < width; x++) {
+                Uint32 colour = lyapunovColour(exponents[(size_t)y * width + x], positive, negative);
+                *out++ = colour >> 16;
+                *out++ = colour >> 8;
+                *out++ = colour;
+            }
+            pngWriteRows(&writer, row, out - row, y == height - 1);
+        }
+        pngEnd(&writer);
+        memoryFree(row);
+    }
+    else {
+        fprintf(file, "Pf\n%d %d\n-1.0\n", width, height);
+        for (int y = height - 1; y >= 0; y--) fwrite(exponents + (size_t)y * width, sizeof(float), width, file);
+    }
+    memoryFree(exponents);
+
+    int status = ferror(file);
+    fclose(file);
+    if (status) fprintf(stderr, "Could not write %s\n", path);
+    return status != 0;
+}
+
+// * BIFURCATION DIAGRAM
+
+double bifurcationParameter(const StrangeAttractor *model, int parameter, double u)
+{
+    // u in [0, 1] across the image, the range is the same as an axis of the Lyapunov map
+    double values[3] = {model->parameters.a, model->parameters.b, model->parameters.c};
+    return values[parameter] + (2 * u - 1) * MAP_SPAN * fmax(fabs(values[parameter]), 1);
+}
+
+void initializeBifurcation(SDL_Renderer *renderer)
+{
+    bifurcation.hits = memoryAlloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(Uint32), MEMORY_FRAMEBUFFERS);
+    bifurcation.pixels = memoryAlloc(SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(Uint32), MEMORY_FRAMEBUFFERS);
+    bifurcation.ready = memoryCalloc(SCREEN_WIDTH, sizeof(SDL_atomic_t), MEMORY_FRAMEBUFFERS);
+    bifurcation.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, SCREEN_WIDTH, SCREEN_HEIGHT);
+    resetBifurcation();
+    return;
+}
+
+void freeBifurcation()
+{
+    resetBifurcation();
+    SDL_DestroyTexture(bifurcation.texture);
+    memoryFree(bifurcation.hits);
+    memoryFree(bifurcation.pixels);
+    memoryFree(bifurcation.ready);
+    bifurcation.hits = NULL;
+    bifurcation.pixels = NULL;
+    bifurcation.ready = NULL;
+    return;
+}
+
+void resetBifurcation()
+{
+    // Columns not started yet see `cancel` and return, the diagram starts over with new pilots
+    if (!bifurcation.hits) return;
+    SDL_AtomicSet(&bifurcation.cancel, 1);
+    jobWait(&bifurcation.group);
+    SDL_AtomicSet(&bifurcation.cancel, 0);
+    memset(bifurcation.hits, 0, SCREEN_WIDTH * SCREEN_HEIGHT * sizeof(Uint32));
+    for (int i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT; i++) bifurcation.pixels[i] = 0xff000000;
+    for (int x = 0; x < SCREEN_WIDTH; x++) SDL_AtomicSet(&bifurcation.ready[x], 0);
+    SDL_UpdateTexture(bifurcation.texture, NULL, bifurcation.pixels, SCREEN_WIDTH * sizeof(Uint32));
+    bifurcation.model = *currentAttractor;
+    bifurcation.started = 0;
+    bifurcation.columns = 0;
+    return;
+}
+
+void startBifurcation()
+{
+    // * Pilot columns spread over the range give the vertical extent, with a margin for the columns in between
+    struct JobGroup pilots = {0};
+    double range[BIFURCATION_PILOTS][2];
+    jobParallelFor(&pilots, bifurcationPilot, "bifurcation pilot", range, 0, BIFURCATION_PILOTS, 1);
+    jobWait(&pilots);
+    bifurcation.bottom = INFINITY;
+    bifurcation.top = -INFINITY;
+    for (int p = 0; p < BIFURCATION_PILOTS; p++) {
+        bifurcation.bottom = fmin(bifurcation.bottom, range[p][0]);
+        bifurcation.top = fmax(bifurcation.top, range[p][1]);
+    }
+    if (!isfinite(bifurcation.bottom) || !isfinite(bifurcation.top)) bifurcation.bottom = bifurcation.top = 0;
+    if (bifurcation.top <= bifurcation.bottom) {
+        bifurcation.bottom -= 1;
+        bifurcation.top += 1;
+    }
+    double margin = 0.05 * (bifurcation.top - bifurcation.bottom);
+    bifurcation.bottom -= margin;
+    bifurcation.top += margin;
+
+    // * Every column is its own job, finished columns stream to the display
+    jobParallelFor(&bifurcation.group, bifurcationColumn, "bifurcation column", &bifurcation, 0, SCREEN_WIDTH, 1);
+    bifurcation.started = 1;
+    return;
+}
+
+void bifurcationPilot(void *data, int begin, int end)
+{
+    double (*range)[2] = data;
+    double *maxima = memoryAlloc(BIFURCATION_MAXIMA * sizeof(double), MEMORY_ENSEMBLE);
+    for (int p = begin; p < end; p++) {
+        StrangeAttractor model = bifurcation.model;
+        double *values[3] = {&model.parameters.a, &model.parameters.b, &model.parameters.c};
+        *values[bifurcation.parameter] = bifurcationParameter(&bifurcation.model, bifurcation.parameter, (p + 0.5) / BIFURCATION_PILOTS);
+        int count = attractorMaxima(&model, bifurcation.coordinate, BIFURCATION_TRANSIENT, BIFURCATION_STEPS / 4, maxima, BIFURCATION_MAXIMA);
+        range[p][0] = INFINITY;
+        range[p][1] = -INFINITY;
+        for (int i = 0; i < count; i++) {
+            range[p][0] = fmin(range[p][0], maxima[i]);
+            range[p][1] = fmax(range[p][1], maxima[i]);
+        }
+    }
+    memoryFree(maxima);
+    return;
+}
+
+void bifurcationColumn(void *data, int begin, int end)
+{
+    // Maxima of one parameter value binned into its own column of hits
+    struct Bifurcation *diagram = data;
+    double *maxima = memoryAlloc(BIFURCATION_MAXIMA * sizeof(double), MEMORY_ENSEMBLE);
+    for (int x = begin; x < end && !SDL_AtomicGet(&diagram->cancel); x++) {
+        StrangeAttractor model = diagram->model;
+        double *values[3] = {&model.parameters.a, &model.parameters.b, &model.parameters.c};
+        *values[diagram->parameter] = bifurcationParameter(&diagram->model, diagram->parameter, (x + 0.5) / SCREEN_WIDTH);
+        int count = attractorMaxima(&model, diagram->coordinate, BIFURCATION_TRANSIENT, BIFURCATION_STEPS, maxima, BIFURCATION_MAXIMA);
+        double scale = SCREEN_HEIGHT / (diagram->top - diagram->bottom);
+        for (int i = 0; i < count; i++) {
+            int y = SCREEN_HEIGHT - 1 - (int)((maxima[i] - diagram->bottom) * scale);
+            if (y >= 0 && y < SCREEN_HEIGHT) diagram->hits[y * SCREEN_WIDTH + x]++;
+        }
+        SDL_AtomicSet(&diagram->ready[x], 1);
+    }
+    memoryFree(maxima);
+    return;
+}
+
+void renderBifurcation(SDL_Renderer *renderer)
+{
+    // * Start over when the model, its parameters or dt changed
+    const StrangeAttractor *model = &bifurcation.model;
+    if (modelChanged(model)) resetBifurcation();
+    if (!bifurcation.started) startBifurcation();
+    if (SDL_AtomicGet(&bifurcation.group.pending)) jobHelp();
+
+    // * Finished columns, each one tone mapped against its own busiest pixel
+    int changed = 0;
+    for (int x = 0; x < SCREEN_WIDTH; x++) {
+        if (SDL_AtomicGet(&bifurcation.ready[x]) != 1) continue;
+        Uint32 max = 0;
+        for (int y = 0; y < SCREEN_HEIGHT; y++) max = SDL_max(max, bifurcation.hits[y * SCREEN_WIDTH + x]);
+        for (int y = 0; y < SCREEN_HEIGHT && max; y++) {
+            Uint32 level = 255 * sqrt(bifurcation.hits[y * SCREEN_WIDTH + x] / (double)max);
+            bifurcation.pixels[y * SCREEN_WIDTH + x] = 0xff000000 | level << 16 | level << 8 | level;
+        }
+        SDL_AtomicSet(&bifurcation.ready[x], 2);
+        bifurcation.columns++;
+        changed = 1;
+    }
+    if (changed) SDL_UpdateTexture(bifurcation.texture, NULL, bifurcation.pixels, SCREEN_WIDTH * sizeof(Uint32));
+    SDL_RenderCopy(renderer, bifurcation.texture, NULL, NULL);
+
+    // * Axes and progress
+    static const char *names = "abc";
+    static const char *coordinates = "xyz";
+    char s[160];
+    sprintf(s, "%c %.2f to %.2f across, maxima of %c %.2f to %.2f up", names[bifurcation.parameter],
+        bifurcationParameter(model, bifurcation.parameter, 0), bifurcationParameter(model, bifurcation.parameter, 1),
+        coordinates[bifurcation.coordinate], bifurcation.bottom, bifurcation.top);
+    stringRGBA(renderer, 10, SCREEN_HEIGHT - 30, s, WHITE);
+    sprintf(s, "Bifurcation diagram, %d of %d columns", bifurcation.columns, SCREEN_WIDTH);
+    stringRGBA(renderer, 10, SCREEN_HEIGHT - 20, s, WHITE);
+    return;
+}
+
+// * POINCARE SECTION
+
+int modelChanged(const StrangeAttractor *snapshot)
+{
+    // Whether the current model, its parameters or dt differ from `snapshot`, views built from it start over
+    return snapshot->attractorFunction != currentAttractor->attractorFunction || snapshot->dtime != currentAttractor->dtime ||
+        snapshot->parameters.a != currentAttractor->parameters.a || snapshot->parameters.b != currentAttractor->parameters.b ||
+        snapshot->parameters.c != currentAttractor->parameters.c;
+}
+
+void defaultSection(const StrangeAttractor *model, int axis, struct Section *plane, double point[3])
+{
+    // Plane normal to `axis` through the mean position after a transient, upward crossings only.
+    // `point` is left on the attractor to continue from
+    double normal[3] = {axis == 0, axis == 1, axis == 2}, mean[3];
+    point[0] = model->initialPosition.x;
+    point[1] = model->initialPosition.y;
+    point[2] = model->initialPosition.z;
+    attractorOrbit(model, point, SECTION_TRANSIENT, NULL);
+    attractorOrbit(model, point, SECTION_TRANSIENT, mean);
+    sectionPlane(plane, normal, mean[axis], 1);
+    return;
+}
+
+void initializeSection()
+{
+    poincare.points = memoryAlloc(SECTION_POINTS * sizeof(*poincare.points), MEMORY_ENSEMBLE);
+    poincare.screen = memoryAlloc(SECTION_POINTS * sizeof(SDL_Point), MEMORY_VERTICES);
+    resetSection();
+    return;
+}
+
+void freeSection()
+{
+    memoryFree(poincare.points);
+    memoryFree(poincare.screen);
+    poincare.points = NULL;
+    poincare.screen = NULL;
+    return;
+}
+
+void resetSection()
+{
+    if (!poincare.points) return;
+    poincare.model = *currentAttractor;
+    defaultSection(&poincare.model, poincare.axis, &poincare.plane, poincare.point);
+    poincare.count = poincare.next = 0;
+    poincare.minimum[0] = poincare.minimum[1] = INFINITY;
+    poincare.maximum[0] = poincare.maximum[1] = -INFINITY;
+    return;
+}
+
+void drawSection(SDL_Renderer *renderer)
+{
+    if (!sectionControl) return;
+    if (modelChanged(&poincare.model)) resetSection();
+
+    // * Crossings of this frame's steps go into the ring, the orbit continues where the last frame left it
+    static double crossings[SECTION_STEPS / 2][2];
+    int found = attractorSection(&poincare.model, &poincare.plane, poincare.point, SECTION_STEPS, crossings, SECTION_STEPS / 2);
+    for (int i = 0; i < found; i++) {
+        for (int k = 0; k < 2; k++) {
+            poincare.points[poincare.next][k] = crossings[i][k];
+            poincare.minimum[k] = fmin(poincare.minimum[k], crossings[i][k]);
+            poincare.maximum[k] = fmax(poincare.maximum[k], crossings[i][k]);
+        }
+        poincare.next = (poincare.next + 1) % SECTION_POINTS;
+        poincare.count = SDL_min(poincare.count + 1, SECTION_POINTS);
+    }
+
+    // * Panel in the top right corner, both axes share one scale so the section isn't distorted
+    int left = SCREEN_WIDTH - SECTION_SIZE - 10, top = 10;
+    boxRGBA(renderer, left - 5, top - 5, left + SECTION_SIZE + 5, top + SECTION_SIZE + 25, 0, 0, 0, 160);
+    double span = fmax(poincare.maximum[0] - poincare.minimum[0], poincare.maximum[1] - poincare.minimum[1]);
+    double scale = span > 0 ? SECTION_SIZE / span : 0;
+    for (int i = 0; i < poincare.count; i++) {
+        poincare.screen[i].x = left + (poincare.points[i][0] - poincare.minimum[0]) * scale;
+        poincare.screen[i].y = top + SECTION_SIZE - (poincare.points[i][1] - poincare.minimum[1]) * scale;
+    }
+    SDL_SetRenderDrawColor(renderer, trail_rgba.rf, trail_rgba.gf, trail_rgba.bf, 255);
+    SDL_RenderDrawPoints(renderer, poincare.screen, poincare.count);
+
+    static const char *names = "xyz";
+    char s[80];
+    sprintf(s, "Section %c = %.2f, %d crossings", names[poincare.axis], poincare.plane.offset, poincare.count);
+    stringRGBA(renderer, left, top + SECTION_SIZE + 10, s, WHITE);
+    return;
+}
+
+int exportSection(int steps, const double *plane, const char *path)
+{
+    // Crossings as plane coordinates and positions, `plane` is a normal and offset or NULL for z through the mean
+    FILE *file = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+    struct Section section;
+    double point[3];
+    defaultSection(currentAttractor, 2, &section, point);
+    if (plane) sectionPlane(&section, plane, plane[3], 1);
+
+    // * Streams in chunks of steps, only one chunk of crossings is held at a time
+    double (*crossings)[2] = memoryAlloc(SECTION_STEPS / 2 * sizeof(*crossings), MEMORY_OUTPUT);
+    long total = 0;
+    fprintf(file, "u,v,x,y,z\n");
+    for (int done = 0; done < steps; done += SECTION_STEPS) {
+        int found = attractorSection(currentAttractor, &section, point, SDL_min(SECTION_STEPS, steps - done), crossings, SECTION_STEPS / 2);
+        for (int i = 0; i < found; i++) {
+            double q[3];
+            for (int k = 0; k < 3; k++) q[k] = section.offset * section.normal[k] + crossings[i][0] * section.u[k] + crossings[i][1] * section.v[k];
+            fprintf(file, "%.17g,%.17g,%.17g,%.17g,%.17g\n", crossings[i][0], crossings[i][1], q[0], q[1], q[2]);
+        }
+        total += found;
+    }
+    memoryFree(crossings);
+    fprintf(stderr, "%s: %ld crossings of %.3f x + %.3f y + %.3f z = %.3f in %d steps\n", attractorNames[attractorType(attractor)], total,
+        section.normal[0], section.normal[1], section.normal[2], section.offset, steps);
+
+    int status = ferror(file);
+    if (file != stdout) fclose(file);
+    if (status) fprintf(stderr, "Could not write %s\n", path);
+    return status != 0;
+}
+
+// * PARAMETER SWEEPS
+
+int parseSweepSpec(const char *path, struct Sweep *sweep)
+{
+    // One "MODEL A B C" per line, MODEL a name or 1-6 and each parameter a value or START:END:COUNT.
+    // A line expands to every combination of its ranges, `#` starts a comment
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+    int capacity = 0, number = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        number++;
+        char *comment = strchr(line, '#');
+        if (comment) *comment = 0;
+        char name[32], fields[3][64];
+        int read = sscanf(line, "%31s %63s %63s %63s", name, fields[0], fields[1], fields[2]);
+        if (read <= 0) continue;
+
+        // * Model and the three ranges
+        int model = -1, counts[3] = {1, 1, 1}, valid = read == 4;
+        double starts[3], ends[3];
+        for (int m = 0; m < MODEL_COUNT; m++) if (!strcmp(name, attractorNames[m])) model = m;
+        if (model < 0 && atoi(name) >= 1 && atoi(name) <= MODEL_COUNT) model = atoi(name) - 1;
+        for (int k = 0; k < 3 && valid; k++) {
+            int used = 0;
+            if (sscanf(fields[k], "%lf:%lf:%d%n", &starts[k], &ends[k], &counts[k], &used) == 3 && !fields[k][used]) valid = counts[k] >= 1;
+            else if (sscanf(fields[k], "%lf%n", &starts[k], &used) == 1 && !fields[k][used]) ends[k] = starts[k];
+            else valid = 0;
+        }
+        if (model < 0 || !valid) {
+            fprintf(stderr, "%s:%d: expected MODEL A B C with values or START:END:COUNT\n", path, number);
+            fclose(file);
+            return 1;
+        }
+
+        // * Every combination, a varies slowest
+        for (int i = 0; i < counts[0] * counts[1] * counts[2]; i++) {
+            if (sweep->count == capacity) {
+                capacity = capacity ? 2 * capacity : 256;
+                sweep->entries = memoryRealloc(sweep->entries, capacity * sizeof(struct SweepEntry), MEMORY_ENSEMBLE);
+            }
+            struct SweepEntry *entry = &sweep->entries[sweep->count++];
+            int index[3] = {i / (counts[1] * counts[2]), i / counts[2] % counts[1], i % counts[2]};
+            entry->model = model;
+            entry->done = 0;
+            for (int k = 0; k < 3; k++)
+                entry->parameters[k] = counts[k] > 1 ? starts[k] + (ends[k] - starts[k]) * index[k] / (counts[k] - 1) : starts[k];
+        }
+    }
+    fclose(file);
+    if (!sweep->count) fprintf(stderr, "%s has no entries\n", path);
+    return !sweep->count;
+}
+
+int loadJournal(struct Sweep *sweep, const char *path, const char *header)
+{
+    // Marks the entries an earlier run finished and opens the journal for appending, -1 when it belongs to another sweep.
+    // Every line ends in a hash of the rest, so a line cut short when the run was killed doesn't count.
+    // A missing or empty journal gets the header
+    int done = 0, last = '\n', headed = 0;
+    FILE *file = fopen(path, "r");
+    if (file) {
+        char line[SWEEP_LINE];
+        if (fgets(line, sizeof(line), file)) {
+            if (strcmp(line, header)) {
+                fprintf(stderr, "%s belongs to a different sweep, expected %s", path, header);
+                fclose(file);
+                return -1;
+            }
+            headed = 1;
+        }
+        while (fgets(line, sizeof(line), file)) {
+            size_t length = strlen(line);
+            last = line[length - 1];
+            char *check = strrchr(line, ',');
+            int index;
+            if (last != '\n' || !check || sscanf(line, "%d,", &index) != 1 || index < 0 || index >= sweep->count) continue;
+            if (strtoull(check + 1, NULL, 16) != (Uint32)hashBytes(CACHE_HASH_SEED, line, check - line)) continue;
+            done += !sweep->entries[index].done;
+            sweep->entries[index].done = 1;
+        }
+        fclose(file);
+    }
+    sweep->journal = fopen(path, "a");
+    if (!sweep->journal) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return -1;
+    }
+    if (!headed) fprintf(sweep->journal, "%sindex,model,a,b,c,l1,l2,l3,dky,escaped,minx,maxx,miny,maxy,minz,maxz,check\n", header);
+    if (last != '\n') fputc('\n', sweep->journal);
+    return done;
+}
+
+int sweepLine(char *line, int index, int model, const double parameters[3], const double result[LYAPUNOV_RESULT])
+{
+    // Journal line of entry `index` from its lyapunovBatchResult(), ending in the hash that marks it complete
+    int n = snprintf(line, SWEEP_LINE, "%d,%s,%.17g,%.17g,%.17g,%.9g,%.9g,%.9g,%.9g,%d", index, attractorNames[model],
+        parameters[0], parameters[1], parameters[2], result[0], result[1], result[2], kaplanYorke(result), (int)result[3]);
+    for (int k = 0; k < 6; k++) n += snprintf(line + n, SWEEP_LINE - n, ",%.9g", result[4 + k]);
+    n += snprintf(line + n, SWEEP_LINE - n, ",%08x\n", (Uint32)hashBytes(CACHE_HASH_SEED, line, n));
+    return n;
+}
+
+void sweepJob(void *data, int begin, int end)
+{
+    struct Sweep *sweep = data;
+    for (int b = begin; b < end; b++) {
+        // * The block's parameter sets integrate together, vectorized across sets
+        const int *members = sweep->pending + sweep->blocks[b];
+        int count = sweep->blocks[b + 1] - sweep->blocks[b];
+        int model = sweep->entries[members[0]].model;
+        double (*parameters)[3] = memoryAlloc(count * sizeof(*parameters), MEMORY_ENSEMBLE);
+        for (int i = 0; i < count; i++) memcpy(parameters[i], sweep->entries[members[i]].parameters, sizeof(parameters[i]));
+        struct LyapunovBatch *batch = lyapunovBatchCreate(&attractorDefaults[model], (const double (*)[3])parameters, count, sweep->interval);
+        lyapunovBatchRun(batch, 0, count, sweep->steps);
+
+        // * Lines are formatted first and appended together, so the lock is only held for the write
+        char *lines = memoryAlloc(count * SWEEP_LINE, MEMORY_OUTPUT);
+        size_t length = 0;
+        for (int i = 0; i < count; i++) {
+            struct CacheKey key;
+            double result[LYAPUNOV_RESULT];
+            lyapunovBatchResult(batch, i, result);
+            lyapunovKey(&attractorDefaults[model], parameters[i], sweep->steps, sweep->interval, &key);
+            cacheStore(resultCache, &key, result, LYAPUNOV_RESULT);
+            length += sweepLine(lines + length, members[i], model, parameters[i], result);
+        }
+        SDL_AtomicLock(&sweep->lock);
+        fwrite(lines, 1, length, sweep->journal);
+        fflush(sweep->journal);
+        SDL_AtomicUnlock(&sweep->lock);
+        SDL_AtomicAdd(&sweep->completed, count);
+        memoryFree(lines);
+        memoryFree(parameters);
+        lyapunovBatchDestroy(batch);
+    }
+    return;
+}
+
+int runSweep(int steps, int interval, const char *specPath, const char *journalPath)
+{
+    // Spectrum, Kaplan-Yorke dimension, escape flag and bounding box for every entry of the spec, appended to the
+    // journal as blocks finish. A journal from a killed run of the same spec is resumed
+    struct Sweep sweep = {0};
+    sweep.steps = steps;
+    sweep.interval = interval > 0 ? interval : LYAPUNOV_RENORMALIZE;
+    if (steps <= LYAPUNOV_TRANSIENT) {
+        fprintf(stderr, "Sweep needs more than %d steps\n", LYAPUNOV_TRANSIENT);
+        return 1;
+    }
+    if (parseSweepSpec(specPath, &sweep)) {
+        memoryFree(sweep.entries);
+        return 1;
+    }
+
+    // * The header ties the journal to the expanded entries and settings
+    Uint64 hash = CACHE_HASH_SEED;
+    for (int i = 0; i < sweep.count; i++) {
+        hash = hashBytes(hash, &sweep.entries[i].model, sizeof(int));
+        hash = hashBytes(hash, sweep.entries[i].parameters, sizeof(sweep.entries[i].parameters));
+    }
+    char header[128];
+    sprintf(header, "# sweep %016llx entries %d steps %d qr %d\n", (unsigned long long)hash, sweep.count, sweep.steps, sweep.interval);
+    int done = loadJournal(&sweep, journalPath, header);
+    if (done < 0) {
+        memoryFree(sweep.entries);
+        return 1;
+    }
+
+    // * Entries in the cache go straight to the journal
+    int cached = 0;
+    for (int i = 0; i < sweep.count; i++) {
+        struct SweepEntry *entry = &sweep.entries[i];
+        struct CacheKey key;
+        double result[CACHE_VALUES];
+        char line[SWEEP_LINE];
+        if (entry->done) continue;
+        lyapunovKey(&attractorDefaults[entry->model], entry->parameters, sweep.steps, sweep.interval, &key);
+        if (!cacheLookup(resultCache, &key, result)) continue;
+        fwrite(line, 1, sweepLine(line, i, entry->model, entry->parameters, result), sweep.journal);
+        entry->done = 1;
+        cached++;
+    }
+    fflush(sweep.journal);
+
+    // * Blocks of pending entries
+    sweep.pending = memoryAlloc(sweep.count * sizeof(int), MEMORY_ENSEMBLE);
+    sweep.blocks = memoryAlloc((sweep.count + 1) * sizeof(int), MEMORY_ENSEMBLE);
+    int pending = 0;
+    for (int i = 0; i < sweep.count; i++) {
+        if (sweep.entries[i].done) continue;
+        int start = sweep.blockCount ? sweep.blocks[sweep.blockCount - 1] : -1;
+        if (start < 0 || pending - start == SWEEP_BLOCK || sweep.entries[sweep.pending[start]].model != sweep.entries[i].model)
+            sweep.blocks[sweep.blockCount++] = pending;
+        sweep.pending[pending++] = i;
+    }
+    sweep.blocks[sweep.blockCount] = pending;
+    fprintf(stderr, "%d entries, %d already in %s, %d from the cache, %d blocks of up to %d, %s kernels\n", sweep.count, done, journalPath, cached, sweep.blockCount, SWEEP_BLOCK, cpuLevelNames[cpuLevel]);
+    done += cached;
+
+    // * The main thread helps with blocks and reports progress in between
+    struct JobGroup group = {0};
+    jobParallelFor(&group, sweepJob, "sweep block", &sweep, 0, sweep.blockCount, 1);
+    int shown = -1;
+    while (SDL_AtomicGet(&group.pending)) {
+        if (!jobHelp()) SDL_Delay(1);
+        int completed = SDL_AtomicGet(&sweep.completed);
+        if (completed != shown) fprintf(stderr, "\r%d of %d", done + completed, sweep.count);
+        shown = completed;
+    }
+    jobWait(&group);
+    fprintf(stderr, "\n");
+
+    int status = ferror(sweep.journal);
+    fclose(sweep.journal);
+    if (status) fprintf(stderr, "Could not write %s\n", journalPath);
+    memoryFree(sweep.entries);
+    memoryFree(sweep.pending);
+    memoryFree(sweep.blocks);
+    return status != 0;
+}
+
+// * BENCHMARKS
+
+int runBenchmarks(const char *path)
+{
+    FILE *file = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", path);
+        return 1;
+    }
+    pinThread();
+    fprintf(stderr, "Kernels: %s to %s\n", cpuLevelNames[CPU_GENERIC], cpuLevelNames[cpuLevel]);
+
+    // * Attractor kernels at every level up to the selected one, in float and double precision, one trajectory and a
+    // batch of independent trajectories. Names carry the level so a baseline is only compared with the same kernels.
+    // The single trajectory steps have no variants, so they are measured once as generic
+    fprintf(file, "{\"benchmarks\":[");
+    int first = 1;
+    enum CpuLevel selected = cpuLevel;
+    static const char *precisions[2] = {"float", "double"};
+    for (enum CpuLevel level = CPU_GENERIC; level <= selected; level++) {
+        cpuLevel = level;
+        for (int m = 0; m < MODEL_COUNT; m++) {
+            for (int precise = 0; precise < 2; precise++) {
+                for (int batch = level != CPU_GENERIC; batch < 2; batch++) {
+                    double samples[BENCH_REPETITIONS], median, mad;
+                    benchKernel(&attractorDefaults[m], batch ? BENCH_BATCH : 1, precise, samples);
+                    benchStatistics(samples, BENCH_REPETITIONS, &median, &mad);
+                    fprintf(file, "%s\n{\"name\":\"kernel/%s/euler/%s/%s/%s\",\"kind\":\"kernel\",\"model\":\"%s\",\"integrator\":\"euler\",\"precision\":\"%s\",\"path\":\"%s\",\"cpu\":\"%s\",\"unit\":\"steps/s\",\"median\":%.6e,\"mad\":%.6e,\"tolerance\":%.2f,\"repetitions\":%d}",
+                        first ? "" : ",", attractorNames[m], precisions[precise], batch ? "batch" : "scalar", cpuLevelNames[level], attractorNames[m], precisions[precise], batch ? "batch" : "scalar", cpuLevelNames[level], median, mad, PERF_TOLERANCE, BENCH_REPETITIONS);
+                    fprintf(stderr, "%-10s %-6s %-6s %-7s %12.4e steps/s (MAD %.2e)\n", attractorNames[m], precisions[precise], batch ? "batch" : "scalar", cpuLevelNames[level], median, mad);
+                    first = 0;
+                }
+            }
+        }
+    }
+    cpuLevel = selected;
+
+    // * Whole trail pipeline into an offscreen software renderer at the selected level, it needs no video driver
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    SDL_Renderer *renderer = surface ? SDL_CreateSoftwareRenderer(surface) : NULL;
+    if (!renderer) {
+        fprintf(stderr, "Could not create offscreen renderer: %s\n", SDL_GetError());
+        if (file != stdout) fclose(file);
+        return 1;
+    }
+    initializeFramebuffer(renderer, SCREEN_WIDTH, SCREEN_HEIGHT);
+    static const char *paths[3] = {"aaline", "geometry", "framebuffer"};
+    for (int length = 1000; length <= BENCH_MAX_TRAIL; length *= 10) {
+        for (int path = 0; path < 3; path++) {
+            struct RenderBenchResult result;
+            benchRender(renderer, length, path, &result);
+            fprintf(file, ",\n{\"name\":\"render/%s/%d/%s\",\"kind\":\"render\",\"path\":\"%s\",\"length\":%d,\"cpu\":\"%s\",\"unit\":\"segments/s\",\"median\":%.6e,\"mad\":%.6e,\"tolerance\":%.2f,\"pixels_per_s\":%.6e,\"frame_ms_p50\":%.4f,\"frame_ms_p95\":%.4f,\"frame_ms_p99\":%.4f,\"repetitions\":%d}",
+                paths[path], length, cpuLevelNames[cpuLevel], paths[path], length, cpuLevelNames[cpuLevel], result.median, result.mad, PERF_RENDER_TOLERANCE, result.pixels, result.p50, result.p95, result.p99, result.frames);
+            fprintf(stderr, "%-11s %8d %12.4e segments/s %12.4e pixels/s  p50 %8.3f ms  p99 %8.3f ms\n", paths[path], length, result.median, result.pixels, result.p50, result.p99);
+        }
+    }
+    freeFramebuffer();
+    freeGeometry();
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    fprintf(file, "\n]}\n");
+
+    int status = ferror(file);
+    if (file != stdout) fclose(file);
+    return status != 0;
+}
+
+int loadBenchResults(const char *path, struct BenchEntry **entries)
+{
+    // Reads back the JSON written by runBenchmarks(), one object per benchmark
+    FILE *file = fopen(path, "rb");
+    if (!file) return -1;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *text = memoryAlloc(size + 1, MEMORY_BENCH);
+    text[fread(text, 1, size, file)] = '\0';
+    fclose(file);
+
+    int count = 0, capacity = 0;
+    *entries = NULL;
+    for (char *object = strstr(text, "{\"name\":\""); object; object = strstr(object + 1, "{\"name\":\"")) {
+        char *end = strchr(object, '}');
+        if (!end) break;
+        *end = '\0';
+        if (count == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            *entries = memoryRealloc(*entries, capacity * sizeof(struct BenchEntry), MEMORY_BENCH);
+        }
+        struct BenchEntry *entry = &(*entries)[count];
+        char *median = strstr(object, "\"median\":"), *mad = strstr(object, "\"mad\":"), *tolerance = strstr(object, "\"tolerance\":");
+        if (sscanf(object, "{\"name\":\"%127[^\"]\"", entry->name) == 1 && median && mad) {
+            entry->median = atof(median + 9);
+            entry->mad = atof(mad + 6);
+            entry->tolerance = tolerance ? atof(tolerance + 12) : PERF_TOLERANCE;
+            count++;
+        }
+        *end = '}';
+        object = end;
+    }
+    memoryFree(text);
+    return count;
+}
+
+int comparePerformance(const char *baselinePath, const char *resultsPath)
+{
+    struct BenchEntry *baseline, *results;
+    int baseline_count = loadBenchResults(baselinePath, &baseline);
+    int results_count = loadBenchResults(resultsPath, &results);
+    if (baseline_count < 0 || results_count < 0) {
+        fprintf(stderr, "Could not read %s, record one with `make baseline`\n", baseline_count < 0 ? baselinePath : resultsPath);
+        memoryFree(baseline_count < 0 ? NULL : baseline);
+        memoryFree(results_count < 0 ? NULL : results);
+        return 2;
+    }
+
+    // * A metric regresses when it is slower by more than its tolerance and the gap is
+    // well outside the combined run-to-run noise (3 sigma, sigma estimated as 1.4826 MAD)
+    int regressions = 0;
+    fprintf(stderr, "\n%-40s %12s %12s %8s\n", "benchmark", "baseline", "current", "change");
+    for (int r = 0; r < results_count; r++) {
+        struct BenchEntry *current = &results[r], *base = NULL;
+        for (int b = 0; b < baseline_count && !base; b++)
+            if (!strcmp(baseline[b].name, current->name)) base = &baseline[b];
+        if (!base) {
+            fprintf(stderr, "%-40s %12s %12.4e %8s\n", current->name, "-", current->median, "new");
+            continue;
+        }
+
+        double change = current->median / base->median - 1;
+        double noise = 3 * 1.4826 * sqrt(base->mad * base->mad + current->mad * current->mad);
+        int slower = change < -base->tolerance && base->median - current->median > noise;
+        regressions += slower;
+        fprintf(stderr, "%-40s %12.4e %12.4e %+7.1f%%%s\n", current->name, base->median, current->median, 100 * change, slower ? "  REGRESSION" : "");
+    }
+
+    // * A baseline entry the run no longer produces fails too, a renamed or dropped benchmark would hide a regression
+    int missing = 0;
+    for (int b = 0; b < baseline_count; b++) {
+        int found = 0;
+        for (int r = 0; r < results_count && !found; r++) found = !strcmp(baseline[b].name, results[r].name);
+        if (found) continue;
+        fprintf(stderr, "%-40s %12.4e %12s %8s\n", baseline[b].name, baseline[b].median, "-", "MISSING");
+        missing++;
+    }
+    fprintf(stderr, "%d regression%s and %d missing benchmark%s against %s\n", regressions, regressions == 1 ? "" : "s", missing, missing == 1 ? "" : "s", baselinePath);
+
+    memoryFree(baseline);
+    memoryFree(results);
+    return regressions + missing != 0;
+}
+
+void benchRender(SDL_Renderer *renderer, int length, int path, struct RenderBenchResult *result)
+{
+    // * Real trajectory of `length` points on the Lorenz model
+    AttractorContext *saved = attractor;
+    useAttractor(attractorCreate(LORENZ));
+    currentAttractor->trail.maxLength = length;
+    attractorResetTrail(attractor);
+    for (int i = 0; i < length; i++) attractorStep(attractor);
+
+    // * Time each frame of simulate, transform, project, clip and rasterize
+    int frames = SDL_clamp(BENCH_MAX_TRAIL / length, BENCH_WARMUP + 5, BENCH_WARMUP + 100) - BENCH_WARMUP;
+    double *rates = memoryAlloc(frames * sizeof(double), MEMORY_BENCH);
+    double *times = memoryAlloc(frames * sizeof(double), MEMORY_BENCH);
+    double frequency = SDL_GetPerformanceFrequency(), seconds = 0;
+    Uint64 pixels = 0;
+    for (int f = -BENCH_WARMUP; f < frames; f++) {
+        Uint64 segments_before = profiler.segments[profiler.frame], pixels_before = profiler.pixels[profiler.frame];
+        Uint64 start = SDL_GetPerformanceCounter();
+        attractorStep(attractor);
+        PROFILE_COUNT(points, transformTrail());
+        clear(renderer);
+        if (path == 0) drawTrail(renderer, 1, 1, 0);
+        else if (path == 1) drawTrailGeometry(renderer);
+        else drawTrailDepth(renderer);
+        SDL_RenderPresent(renderer);
+        Uint64 end = SDL_GetPerformanceCounter();
+        if (f < 0) continue;
+
+        times[f] = (end - start) / frequency;
+        rates[f] = (profiler.segments[profiler.frame] - segments_before) / times[f];
+        pixels += profiler.pixels[profiler.frame] - pixels_before;
+        seconds += times[f];
+    }
+
+    // * Robust rate, fill rate and frame time percentiles
+    benchStatistics(rates, frames, &result->median, &result->mad);
+    qsort(times, frames, sizeof(double), compareDoubles);
+    result->pixels = pixels / seconds;
+    result->p50 = 1000 * times[frames / 2];
+    result->p95 = 1000 * times[(frames * 95) / 100];
+    result->p99 = 1000 * times[(frames * 99) / 100];
+    result->frames = frames;
+    memoryFree(rates);
+    memoryFree(times);
+
+    attractorDestroy(attractor);
+    if (saved) useAttractor(saved);
+    return;
+}
+
+void benchKernel(const StrangeAttractor *model, int batch, int precise, double *samples)
+{
+    // Every repetition restarts the same trajectories so runs see the same numbers. A single trajectory goes through
+    // the model's function, or attractorOrbit() when `precise`, a batch through the float or double integrator for
+    // this CPU
+    static struct Point points[BENCH_BATCH];
+    static float x[BENCH_BATCH], y[BENCH_BATCH], z[BENCH_BATCH];
+    static double px[BENCH_BATCH], py[BENCH_BATCH], pz[BENCH_BATCH], point[3];
+    int rounds = BENCH_STEPS / batch;
+    volatile float sink = 0;
+    double frequency = SDL_GetPerformanceFrequency();
+
+    for (int r = -BENCH_WARMUP; r < BENCH_REPETITIONS; r++) {
+        for (int i = 0; i < batch; i++) {
+            points[i].x = model->initialPosition.x + 0.001 * i;
+            points[i].y = model->initialPosition.y;
+            points[i].z = model->initialPosition.z;
+            x[i] = px[i] = points[i].x;
+            y[i] = py[i] = points[i].y;
+            z[i] = pz[i] = points[i].z;
+        }
+        point[0] = px[0];
+        point[1] = py[0];
+        point[2] = pz[0];
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        if (batch > 1 && precise) attractorIntegrateDouble(model, px, py, pz, batch, rounds);
+        else if (batch > 1) attractorIntegrate(model, x, y, z, batch, rounds);
+        else if (precise) attractorOrbit(model, point, rounds, NULL);
+        else {
+            for (int s = 0; s < rounds; s++) {
+                struct Point next;
+                model->attractorFunction(&next, &points[0], model);
+                points[0] = next;
+            }
+        }
+        Uint64 end = SDL_GetPerformanceCounter();
+        sink += points[0].x + x[0] + px[0] + point[0];
+
+        // Negative repetitions are warm up
+        if (r >= 0) samples[r] = (double)rounds * batch * frequency / (end - start);
+    }
+    return;
+}
+
+int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+void benchStatistics(double *samples, int n, double *median, double *mad)
+{
+    // Median and median absolute deviation, both robust to the odd preempted run
+    double deviations[n];
+    qsort(samples, n, sizeof(double), compareDoubles);
+    *median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+    for (int i = 0; i < n; i++) deviations[i] = fabs(samples[i] - *median);
+    qsort(deviations, n, sizeof(double), compareDoubles);
+    *mad = n % 2 ? deviations[n / 2] : (deviations[n / 2 - 1] + deviations[n / 2]) / 2;
+    return;
+}
+
+void pinThread()
+{
+    // Keep the benchmark on one core so migrations don't show up as noise
+    #ifdef _WIN32
+        SetThreadAffinityMask(GetCurrentThread(), 1);
+    #elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(0, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    #endif
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+    return;
+}
+
+void selectCpuLevel(const char *cap)
+{
+    // Best kernels this CPU can run, `cap` names a level to stay at or below. The main thread flushes denormals
+    // like the job workers do
+    cpuFlushDenormals();
+    cpuLevel = CPU_GENERIC;
+    if (SDL_HasSSE2()) cpuLevel = CPU_SSE2;
+    if (SDL_HasAVX()) cpuLevel = CPU_AVX;
+    if (SDL_HasAVX2()) cpuLevel = CPU_AVX2;
+    if (SDL_HasAVX512F()) cpuLevel = CPU_AVX512;
+    for (enum CpuLevel level = CPU_GENERIC; cap && level < cpuLevel; level++) {
+        if (!strcmp(cap, cpuLevelNames[level])) cpuLevel = level;
+    }
     return;
 }
@@ -1,28 +1,91 @@
 #ifndef STRANGE_ATTRACTORS_H
 #define STRANGE_ATTRACTORS_H
+#define _GNU_SOURCE
 
 // * HEADERS
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <SDL.h>
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <sched.h>
+#endif
 #include <math.h>
+#include <float.h>
 #include "lib/SDL2_gfx/SDL2_gfxPrimitives.h"
+#include "attractorCore.h"
+#include "memoryTracker.h"
+#include "jobSystem.h"
 
 // * MACRODEFINITIONS
-#define SCREEN_WIDTH (1280)
-#define SCREEN_HEIGHT (780)
+#define SCREEN_WIDTH VIEW_WIDTH
+#define SCREEN_HEIGHT VIEW_HEIGHT
 #define RGB_MAX (255)
-#define PI (3.14152)
 #define WHITE 255, 255, 255, 255
 #define BLACK 0, 0, 0, 255
 #define CIRCLE
-#define MODEL_COUNT 6
+#define DENSITY_STEPS (250000)
+#define DENSITY_TRANSIENT (1000)
+#define DENSITY_LANES (16)
+#define RASTER_SPAN (64)
+#define TONE_LEVELS (4096)
+#define TRANSFORM_GRAIN (16384)
+#define LYAPUNOV_STEPS (4000)
+#define LYAPUNOV_CHAOTIC (0.01)
+#define SPECTRUM_CHUNK (10000)
+#define SPECTRUM_GRAIN (16)
+#define MAP_WIDTH (SCREEN_WIDTH / 2)
+#define MAP_HEIGHT (SCREEN_HEIGHT / 2)
+#define MAP_LEVELS (5)
+#define MAP_STEPS (6000)
+#define MAP_CHUNK (500)
+#define MAP_GRAIN (64)
+#define MAP_BAND (64)
+#define MAP_SPAN (0.5)
+#define BIFURCATION_TRANSIENT (10000)
+#define BIFURCATION_STEPS (200000)
+#define BIFURCATION_MAXIMA (4096)
+#define BIFURCATION_PILOTS (16)
+#define SECTION_TRANSIENT (10000)
+#define SECTION_STEPS (20000)
+#define SECTION_POINTS (65536)
+#define SECTION_SIZE (320)
+#define SWEEP_BLOCK (64)
+#define SWEEP_LINE (512)
+#define CACHE_FILE "strangeAttractors.cache"
+#define WARM_TRANSIENT (10000)
+#define WARM_CHUNK (1000)
+#define FRAMEBUFFER_ROWS (32)
+#define DEPTH_FOG (0.8)
+#define PROFILE_FRAMES 240
+#define TRACE_EVENTS (1 << 16)
+#define BENCH_STEPS (2000000)
+#define BENCH_BATCH 64
+#define BENCH_WARMUP 2
+#define BENCH_REPETITIONS 15
+#define BENCH_MAX_TRAIL (1000000) // The trail is a list of allocated points, 10^7 of them would take about a gigabyte
+#define PERF_TOLERANCE (0.05)
+#define PERF_RENDER_TOLERANCE (0.15) // Render rates and frame times also depend on the allocator, caches and scheduler
+#define PERF_RESULTS "bench.json"
+#define POSTER_TILE_HEIGHT (256)
+#define VIDEO_QUEUE_DEPTH 3
+#define VIDEO_FPS 60
 
 // * GENERAL EXTERNAL VARIABLES
-float aspect_ratio = SCREEN_WIDTH/SCREEN_HEIGHT;
-float FOV = 3.5;
 int settings = 0;
 int colourControl = 0;
+int densityControl = 0;
+int depthControl = 0;
+int fogControl = 1;
+int profilerControl = 0;
+int geometryControl = 0;
+int mapControl = 0;
+int bifurcationControl = 0;
+int sectionControl = 0;
 
 struct UserMouse {
     int down;
@@ -36,16 +99,6 @@ struct UserMouse {
     .down = 0,
 };
 
-struct Frustum {
-    float r;
-    float t;
-    float n;
-    float f;
-} frustum = {
-    .n = 0.05,
-    .f = 20.0
-};
-
 struct Trail_Colour {
     int ri;
     int rf;
@@ -124,158 +177,390 @@ struct Sliders {
 };
 
 
-// * STRANGE ATTRACTORS
+// * CURRENT ATTRACTOR
+// The core context and shortcuts to the parts of it the front end touches every frame
+AttractorContext *attractor;
+StrangeAttractor *currentAttractor;
+struct VertexBuffer *trailVertices;
+const struct Frustum *frustum;
+
+// Quads for the batched SDL_RenderGeometry() trail
+struct {
+    SDL_Vertex *vertices;
+    int *indices;
+    int capacity;
+} geometry;
+
+// * DEPTH RENDERER
+// Software framebuffer with a depth buffer, used instead of SDL2_gfx when depth testing is on
+struct Framebuffer {
+    Uint32 *pixels;
+    float *depth;
+    int width;
+    int height;
+    float near;
+    float far;
+    SDL_Texture *texture;
+} framebuffer;
 
-struct Point {
-    struct Point *next;
-    float x;
-    float y;
-    float z;
+// * PROFILER
+// Per stage performance counter ticks for the last `PROFILE_FRAMES` frames
+enum ProfileStage {
+    STAGE_SIMULATE,
+    STAGE_TRANSFORM,
+    STAGE_RASTERIZE,
+    STAGE_CONTROLS,
+    STAGE_PRESENT,
+    STAGE_FRAME,
+    STAGE_COUNT
 };
+const char *stageNames[STAGE_COUNT] = {"simulate", "transform", "rasterize", "controls", "present", "frame"};
+struct Profiler {
+    Uint64 start[STAGE_COUNT];
+    Uint64 ticks[PROFILE_FRAMES][STAGE_COUNT];
+    Uint64 points[PROFILE_FRAMES];
+    Uint64 segments[PROFILE_FRAMES];
+    Uint64 pixels[PROFILE_FRAMES];
+    Uint64 allocations[PROFILE_FRAMES];
+    int frame;
+    int frames;
+} profiler;
+#define PROFILE_BEGIN(stage) (profiler.start[stage] = SDL_GetPerformanceCounter(), traceEvent(TRACE_MAIN, stageNames[stage], 'B'))
+#define PROFILE_END(stage) (profiler.ticks[profiler.frame][stage] += SDL_GetPerformanceCounter() - profiler.start[stage], traceEvent(TRACE_MAIN, stageNames[stage], 'E'))
+#define PROFILE_COUNT(counter, n) (profiler.counter[profiler.frame] += (n))
 
-// Attractor Function Prototypes
-void BanlueAttractor(struct Point *newPoint);
-void LorenzAttractor(struct Point *newPoint);
-void HalvorsenAttractor(struct Point *newPoint);
-void AizawaAttractor(struct Point *newPoint);
-void LuChenAttractor(struct Point *newPoint);
-void GenesioAttractor(struct Point *newPoint);
-
-// Strange Attractor Models
-double default_x = 0.01;
-double default_y = 0.01;
-double default_z = 0.01;
-typedef struct {
-    double dtime;
-    double zoom;
-    void (*attractorFunction)(struct Point*);
-    struct {
-        double a;
-        double b;
-        double c;
-        double d;
-        double e;
-    } parameters;
-    struct {
-        double x;
-        double y;
-        double z;
-    } initialPosition;
-    struct {
-        float x;
-        float y;
-        float z;
-    } midpoint;
-    struct {
-        double angle_x;
-        double angle_y;
-        double angle_z;
-        double dangle_x;
-        double dangle_y;
-        double dangle_z;
-    } rotation;
-    struct {
-        struct Point *head;
-        struct Point *tail;
-        int length;
-        int maxLength;
-    } trail;
-} StrangeAttractor;
-StrangeAttractor defaultModel; // Model used to store original settings
-StrangeAttractor AttractorModels[MODEL_COUNT] = {
-    // ? LORENZ MODEL
-    {
-        .dtime = 0.005,
-        .zoom = 0.17,
-        .attractorFunction = LorenzAttractor,
-        .parameters = {10.0, 28.0, 8.0/3.0},
-        .initialPosition = {0.8, 0.5, 4.1},
-        .midpoint = {1.94, 3.53, 25.57},
-        .rotation = {.dangle_x = 0.000000, 0.000001, 0.000000},
-        .trail = {.maxLength = 1000,}
-    },
-    // ? BANLUE MODEL
-    {
-        .dtime = 0.02,
-        .zoom = 0.25,
-        .attractorFunction = BanlueAttractor,
-        .parameters = {2, 0, 0},
-        .initialPosition = {0.8, 0.5, 0.1},
-        .midpoint = {-0.18, -0.34, 0.75},
-        .rotation = {.dangle_x = 0.000002, 0.000001, 0.000000},
-        .trail = {.maxLength = 1000}
-    },
-    // ? HALVORSEN MODEL
-    {
-        .dtime = 0.02,
-        .zoom = 0.2,
-        .attractorFunction = HalvorsenAttractor,
-        .parameters = {1.97, 0, 0},
-        .initialPosition = {0.8, 0.5, 4.1},
-        .midpoint = {-2.28, -3.88, -4.41},
-        .rotation = {.dangle_x = 0.000002, 0.000001, 0.000000},
-        .trail = {.maxLength = 3000}
-    },
-    // ? AIZAWA MODEL
-    {
-        .dtime = 0.0145,
-        .zoom = 0.65,
-        .attractorFunction = AizawaAttractor,
-        .parameters = {0.25, 0.96, 3.5},
-        .initialPosition = {0.01, 0.01, 0.01},
-        .midpoint = {-0.01, 0.05, 0.61},
-        .rotation = {.dangle_x = 0.000000, 0.000001, 0.0000005},
-        .trail = {.maxLength = 1000}
-    },
-    // ? LUCHEN MODEL
-    {
-        .dtime = 0.0027,
-        .zoom = 0.19,
-        .attractorFunction = LuChenAttractor,
-        .parameters = {-10.0, -4.0, 18.1},
-        .initialPosition = {0.8, 0.5, 4.1},
-        .midpoint = {3.29, 4.07, 18.24},
-        .rotation = {1.2, 0.2, 4.2, 0.000000, 0.000001, 0.000000},
-        .trail = {.maxLength = 2000}
-    },
-    // ? GENESIO MODEL
-    {
-        .dtime = 0.022,
-        .zoom = 0.75,
-        .attractorFunction = GenesioAttractor,
-        .parameters = {0.439, 1.1, 1.0},
-        .initialPosition = {0.1, 0.1, 0.0},
-        .midpoint = {0.34, 0.14, 0.05},
-        .rotation = {.dangle_x = 0.000000, 0.000002, 0.000001},
-        .trail = {.maxLength = 1000}
-    },
+// * BENCHMARKS
+struct BenchEntry {
+    char name[128];
+    double median;
+    double mad;
+    double tolerance;
+};
+struct RenderBenchResult {
+    double median;
+    double mad;
+    double pixels;
+    double p50;
+    double p95;
+    double p99;
+    int frames;
 };
 
-// Current attractor
-enum StrangeAttractorType {
-    LORENZ,
-    BANLUE,
-    HALVORSEN,
-    AIZAWA,
-    LUCHEN,
-    GENESIO,
-} currentAttractorType;
-StrangeAttractor *currentAttractor;
+// * TRACE
+// Begin/end events recorded with `--trace`, one buffer per lane (a thread or a worker slot)
+enum TraceLanes {
+    TRACE_MAIN,
+    TRACE_WRITER,
+    TRACE_WORKERS,
+    TRACE_LANES = TRACE_WORKERS + 64
+};
+struct TraceEvent {
+    const char *name;
+    Uint64 ticks;
+    char phase;
+};
+struct TraceLane {
+    struct TraceEvent *events;
+    int count;
+};
+struct Trace {
+    const char *path;
+    Uint64 start;
+    Uint64 frequency;
+    struct TraceLane lanes[TRACE_LANES];
+} trace;
+
+// * POSTER RENDERER
+struct PngWriter {
+    FILE *file;
+    Uint32 adler_a;
+    Uint32 adler_b;
+    int started;
+};
+
+// * WARM START
+// Every model's default trail after WARM_TRANSIENT steps, computed by one job per model at startup so switching
+// models shows the whole attractor at once. The position after the transient is kept in the result cache.
+// `finite` is 0 for a model whose orbit escapes before the trail ends, it keeps growing its trail from the start
+struct WarmStart {
+    float (*trails[MODEL_COUNT])[3];
+    int finite[MODEL_COUNT];
+    struct JobGroup group;
+};
+
+// * TRAIL RESIMULATION
+// Changing a, b, c or dt starts a job that settles a whole new trail for the new values. Every request takes the next
+// `generation`, jobs of older generations give up and the newest finished one is swapped into `ready` for the frame loop
+struct TrailRequest {
+    StrangeAttractor model;
+    int generation;
+    int finite;
+    float (*points)[3];
+};
+
+struct Resimulation {
+    StrangeAttractor model;
+    SDL_atomic_t generation;
+    void *ready;
+    struct JobGroup group;
+};
+
+// * LYAPUNOV SPECTRUM
+// Steps the next chunk of a headless spectrum run, each job takes a range of parameter sets
+struct SpectrumRun {
+    struct LyapunovBatch *batch;
+    int steps;
+};
+
+// * LYAPUNOV MAP
+// Largest exponent over a grid of (a, b) or (b, c), `axes` 0 or 1. Level l computes the pixels on a grid of
+// 1 << (MAP_LEVELS - 1 - l) that coarser levels skipped and paints each one's block until a finer level replaces it
+struct LyapunovMap {
+    StrangeAttractor model;
+    int axes;
+    int level;
+    int count;
+    int *indices;
+    float *exponents;
+    Uint32 *pixels;
+    float positive;
+    float negative;
+    struct LyapunovBatch *batch;
+    struct JobGroup group;
+    SDL_atomic_t cancel;
+    SDL_Texture *texture;
+};
+
+// * BIFURCATION DIAGRAM
+// Local maxima of `coordinate` for each value of `parameter` across the image, one job per column. A column's hits
+// are only written by its job, which sets `ready` to 1 when done and the frame loop sets it to 2 once it is drawn.
+// `bottom` and `top` come from a few pilot columns computed before the others start
+struct Bifurcation {
+    StrangeAttractor model;
+    int parameter;
+    int coordinate;
+    int started;
+    int columns;
+    double bottom;
+    double top;
+    Uint32 *hits;
+    Uint32 *pixels;
+    SDL_atomic_t *ready;
+    struct JobGroup group;
+    SDL_atomic_t cancel;
+    SDL_Texture *texture;
+};
+
+// * POINCARE SECTION
+// Crossings of a plane normal to `axis` through the mean position, from a double precision orbit that advances every
+// frame. `points` is a ring of the latest SECTION_POINTS crossings and `minimum`, `maximum` only ever grow
+struct PoincareSection {
+    StrangeAttractor model;
+    struct Section plane;
+    int axis;
+    double point[3];
+    double (*points)[2];
+    SDL_Point *screen;
+    int count;
+    int next;
+    double minimum[2];
+    double maximum[2];
+};
+
+// * PARAMETER SWEEPS
+// One (model, a, b, c) of a sweep, entries are numbered in the order the spec expands to them
+struct SweepEntry {
+    int model;
+    double parameters[3];
+    int done;
+};
+
+// `pending` lists the entries the journal doesn't have yet. Block b, one job with its own LyapunovBatch, is the run
+// of up to SWEEP_BLOCK pending entries of one model from pending[blocks[b]] up to pending[blocks[b + 1]]
+struct Sweep {
+    struct SweepEntry *entries;
+    int count;
+    int *pending;
+    int *blocks;
+    int blockCount;
+    int steps;
+    int interval;
+    FILE *journal;
+    SDL_SpinLock lock;
+    SDL_atomic_t completed;
+};
+
+// * VIDEO EXPORT
+// Parameters move linearly from the model's values to `a`, `b`, `c` and the view turns `turns` times around Y
+struct VideoKeyframes {
+    int parameters;
+    double a;
+    double b;
+    double c;
+    double turns;
+};
+
+// Bounded ring of frames shared by the renderer and the writer thread. `failed` is set by the writer when a write
+// fails, from then on it drops frames and the renderer stops
+struct VideoQueue {
+    Uint8 *frames[VIDEO_QUEUE_DEPTH];
+    int head;
+    int count;
+    int done;
+    int failed;
+    size_t frameSize;
+    int y4m;
+    FILE *file;
+    SDL_mutex *lock;
+    SDL_cond *filled;
+    SDL_cond *emptied;
+};
+
+// * DENSITY RENDERER
+// Hit counts are accumulated into one private buffer per thread of the job pool and merged
+// into `hits` once every thread has finished its batch of steps
+struct DensityWorker {
+    Uint32 *hits;
+    float x[DENSITY_LANES];
+    float y[DENSITY_LANES];
+    float z[DENSITY_LANES];
+    StrangeAttractor model;
+    float rotation[3][3];
+    Uint32 seed;
+    int warm;
+};
+// Tables of the tone mapping, rebuilt every frame
+struct ToneMap {
+    float levels[TONE_LEVELS];
+    Uint32 gradient[RGB_MAX + 1];
+    int alphas[RGB_MAX + 1];
+    float scale;
+    float exponent;
+};
+
+struct Density {
+    Uint32 *hits;
+    Uint32 *pixels;
+    Uint32 max;
+    Uint64 samples;
+    float gamma;
+    SDL_Texture *texture;
+    struct DensityWorker *workers;
+    int workerCount;
+} density = {
+    .gamma = 2.2
+};
+
+struct WarmStart warmStart;
+struct Resimulation resimulation;
+struct LyapunovMap lyapunovMap;
+struct Bifurcation bifurcation = {
+    .parameter = 1,
+    .coordinate = 2
+};
+
+struct PoincareSection poincare = {
+    .axis = 2
+};
+
+// Spectra and map pixels computed before, NULL with --cache off
+struct ResultCache *resultCache;
 
 // * GENERAL FUNCTION PROTOTYPES
-void project(float x, float y, float z, float *xp, float *yp, float *zp);
+void useAttractor(AttractorContext *context);
+void freeGeometry();
+void drawTrail(SDL_Renderer *renderer, float scale_x, float scale_y, float offset_y);
+void drawTrailGeometry(SDL_Renderer *renderer);
 void clear(SDL_Renderer *renderer);
 void handleEvents(int *running);
-void rotateX(float *x, float *y, float *z, float angle);
-void rotateY(float *x, float *y, float *z, float angle);
-void rotateZ(float *x, float *y, float *z, float angle);
-void calculateAttractor();
-void freeModel(struct Point *head);
-void initializeModel();
-void initializeFrustum();
 void controls(SDL_Renderer *renderer);
 void getTrailRGBA(int ri, int rf, int gi, int gf, int bi, int bf, int ai, int af, int pos, int length, int *r, int *g, int *b, int *a);
 void trailColourControl(SDL_Renderer *renderer);
 void setCurrentAttractor(enum StrangeAttractorType newAttractorType);
+void profileFrame();
+void initializeTrace(const char *path);
+void traceEvent(int lane, const char *name, char phase);
+void traceJob(int index, const char *name, char phase);
+void writeTrace();
+int compareTicks(const void *a, const void *b);
+void drawProfiler(SDL_Renderer *renderer);
+int runBenchmarks(const char *path);
+void benchKernel(const StrangeAttractor *model, int batch, int precise, double *samples);
+int loadBenchResults(const char *path, struct BenchEntry **entries);
+int comparePerformance(const char *baselinePath, const char *resultsPath);
+void benchRender(SDL_Renderer *renderer, int length, int path, struct RenderBenchResult *result);
+int compareDoubles(const void *a, const void *b);
+void benchStatistics(double *samples, int n, double *median, double *mad);
+void pinThread();
+void selectCpuLevel(const char *cap);
+void initializeFramebuffer(SDL_Renderer *renderer, int width, int height);
+void freeFramebuffer();
+int transformTrail();
+void transformJob(void *data, int begin, int end);
+void clearFramebuffer(void *data, int begin, int end);
+void drawTrailDepth(SDL_Renderer *renderer);
+void rasterizeSegment(struct Framebuffer *target, const struct Vertex *p0, const struct Vertex *p1, int r, int g, int b, int a);
+int renderPoster(int width, int height, const char *path);
+int renderVideo(int frames, const char *path, struct VideoKeyframes *keyframes);
+int videoWriter(void *data);
+void convertFrame(SDL_Surface *surface, Uint8 *frame, int y4m);
+Uint32 crc32(Uint32 crc, const Uint8 *data, size_t length);
+void pngChunk(struct PngWriter *writer, const char *type, const Uint8 *data, Uint32 length);
+void pngBegin(struct PngWriter *writer, int width, int height);
+void pngWriteRows(struct PngWriter *writer, const Uint8 *rows, size_t length, int last);
+void pngEnd(struct PngWriter *writer);
+void initializeDensity(SDL_Renderer *renderer);
+void freeDensity();
+void resetDensity();
+void densityWorker(void *data, int begin, int end);
+void densityBatch(struct DensityWorker *worker);
+void mergeDensity(void *data, int begin, int end);
+void accumulateDensity();
+void toneMapRows(void *data, int begin, int end);
+void renderDensity(SDL_Renderer *renderer);
+int runSpectrum(enum StrangeAttractorType type, int steps, int interval, const char *setsPath, const char *path);
+void spectrumJob(void *data, int begin, int end);
+void initializeWarmStart();
+void freeWarmStart();
+void warmStartJob(void *data, int begin, int end);
+void applyWarmStart(enum StrangeAttractorType type);
+int settleTrail(const StrangeAttractor *model, float (*points)[3], int count, int generation);
+void resetResimulation();
+void freeResimulation();
+void freeTrailRequest(struct TrailRequest *request);
+void trailJob(void *data, int begin, int end);
+void updateTrail();
+void openResultCache(const char *path);
+void closeResultCache();
+void mapParameters(const StrangeAttractor *model, int axes, double u, double v, double parameters[3]);
+Uint32 lyapunovColour(float exponent, float positive, float negative);
+void initializeLyapunovMap(SDL_Renderer *renderer);
+void freeLyapunovMap();
+void resetLyapunovMap();
+void startMapLevel();
+void mapFill(struct LyapunovMap *map, int pixel, float exponent);
+void mapJob(void *data, int begin, int end);
+void renderLyapunovMap(SDL_Renderer *renderer);
+int renderLyapunovMapFile(int width, int height, int axes, int interval, const char *path);
+double bifurcationParameter(const StrangeAttractor *model, int parameter, double u);
+void initializeBifurcation(SDL_Renderer *renderer);
+void freeBifurcation();
+void resetBifurcation();
+void startBifurcation();
+void bifurcationPilot(void *data, int begin, int end);
+void bifurcationColumn(void *data, int begin, int end);
+void renderBifurcation(SDL_Renderer *renderer);
+int modelChanged(const StrangeAttractor *snapshot);
+void defaultSection(const StrangeAttractor *model, int axis, struct Section *plane, double point[3]);
+void initializeSection();
+void freeSection();
+void resetSection();
+void drawSection(SDL_Renderer *renderer);
+int exportSection(int steps, const double *plane, const char *path);
+int parseSweepSpec(const char *path, struct Sweep *sweep);
+int loadJournal(struct Sweep *sweep, const char *path, const char *header);
+int sweepLine(char *line, int index, int model, const double parameters[3], const double result[LYAPUNOV_RESULT]);
+void sweepJob(void *data, int begin, int end);
+int runSweep(int steps, int interval, const char *specPath, const char *journalPath);
 
 #endif